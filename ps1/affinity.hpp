@@ -0,0 +1,264 @@
+#ifndef affinity_hpp
+#define affinity_hpp
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Optional worker pinning (affinity=compact|scatter, Linux only). The
+// topology comes from /sys/devices/system: each CPU's package and core, and
+// the NUMA node whose cpulist contains it. Only CPUs in the process's
+// affinity mask are used.
+//   compact  worker i goes to the i-th CPU ordered by (node, package, core,
+//            cpu): hardware threads of one core are adjacent, and workers
+//            fill one node before moving to the next.
+//   scatter  one CPU per core first, dealt round-robin across nodes, so
+//            workers spread over every node before any two share a core.
+// With more workers than CPUs the order wraps around. Worker threads pin
+// themselves before allocating anything, so their scratch (e.g. sieve
+// segments) is first-touched on their own node. Shared result bitsets are
+// zeroed by threads pinned like the workers (first_touch_zero), so each
+// page lands on the node of the worker whose static slice writes it.
+// Elsewhere the topology is just the hardware threads and pinning is a
+// no-op (planned_cpu returns -1).
+enum class Affinity { None, Compact, Scatter };
+
+struct CpuInfo {
+    int cpu = 0;
+    int node = 0;
+    int package = 0;
+    int core = 0;
+};
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+inline std::vector<int> parse_cpu_list(const std::string& s) {
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (part.empty() || part == "\n") continue;
+        try {
+            std::size_t dash = part.find('-');
+            int a = std::stoi(part.substr(0, dash));
+            int b = dash == std::string::npos ? a : std::stoi(part.substr(dash + 1));
+            for (int c = a; c <= b; ++c) out.push_back(c);
+        } catch (...) {}
+    }
+    return out;
+}
+
+// Worker slot -> CPU order for a mode, from a topology. Pure, so it can be
+// checked against synthetic machines.
+inline std::vector<CpuInfo> placement_order(std::vector<CpuInfo> cpus, Affinity mode) {
+    auto by_topology = [](const CpuInfo& a, const CpuInfo& b) {
+        return std::tie(a.node, a.package, a.core, a.cpu) < std::tie(b.node, b.package, b.core, b.cpu);
+    };
+    std::sort(cpus.begin(), cpus.end(), by_topology);
+    if (mode != Affinity::Scatter) return cpus;
+
+    // rank 0 = first hardware thread of its core, 1 = its sibling, ...
+    std::map<int, std::vector<std::pair<int, CpuInfo>>> per_node;  // node -> (rank, cpu)
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+        int rank = 0;
+        for (std::size_t j = i; j-- > 0 && cpus[j].node == cpus[i].node &&
+                                cpus[j].package == cpus[i].package && cpus[j].core == cpus[i].core; )
+            ++rank;
+        per_node[cpus[i].node].push_back({rank, cpus[i]});
+    }
+    for (auto& [node, list] : per_node)
+        std::stable_sort(list.begin(), list.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+    std::vector<CpuInfo> out;
+    for (std::size_t i = 0; out.size() < cpus.size(); ++i)
+        for (auto& [node, list] : per_node)
+            if (i < list.size()) out.push_back(list[i].second);
+    return out;
+}
+
+class Topology {
+public:
+    static const Topology& get() {
+        static const Topology t;
+        return t;
+    }
+
+    const std::vector<CpuInfo>& cpus() const noexcept { return cpus_; }
+    int nodes() const noexcept { return nodes_; }
+
+    const CpuInfo* find(int cpu) const {
+        for (const CpuInfo& c : cpus_)
+            if (c.cpu == cpu) return &c;
+        return nullptr;
+    }
+
+private:
+    Topology() {
+#ifdef __linux__
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if (sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+            for (unsigned c = 0; c < std::max(1u, std::thread::hardware_concurrency()); ++c) CPU_SET(c, &mask);
+        }
+        std::map<int, int> node_of;
+        std::string online;
+        std::vector<int> nodes;
+        if (read_line("/sys/devices/system/node/online", online)) nodes = parse_cpu_list(online);
+        for (int n : nodes) {
+            std::string list;
+            if (!read_line("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist", list)) continue;
+            for (int c : parse_cpu_list(list)) node_of[c] = n;
+        }
+        nodes_ = std::max<int>(1, static_cast<int>(nodes.size()));
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (!CPU_ISSET(c, &mask)) continue;
+            CpuInfo info;
+            info.cpu = c;
+            info.node = node_of.count(c) ? node_of[c] : 0;
+            std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/", v;
+            info.package = read_line(base + "physical_package_id", v) ? std::atoi(v.c_str()) : 0;
+            info.core = read_line(base + "core_id", v) ? std::atoi(v.c_str()) : c;
+            cpus_.push_back(info);
+        }
+#else
+        for (unsigned c = 0; c < std::max(1u, std::thread::hardware_concurrency()); ++c)
+            cpus_.push_back({static_cast<int>(c), 0, 0, static_cast<int>(c)});
+#endif
+    }
+
+    static bool read_line(const std::string& path, std::string& out) {
+        std::ifstream in(path);
+        return static_cast<bool>(std::getline(in, out));
+    }
+
+    std::vector<CpuInfo> cpus_;
+    int nodes_ = 1;
+};
+
+// Where each worker ended up, for the [AFFINITY] report.
+class PlacementLog {
+public:
+    static PlacementLog& get() {
+        static PlacementLog log;
+        return log;
+    }
+
+    void record(unsigned idx, int cpu, bool pinned) {
+        std::lock_guard<std::mutex> lk(m_);
+        if (workers_.size() <= idx) workers_.resize(idx + 1, {-1, false});
+        workers_[idx] = {cpu, pinned};
+    }
+    void first_touch(std::size_t bytes) {
+        std::lock_guard<std::mutex> lk(m_);
+        first_touch_bytes_ += bytes;
+    }
+
+    // mode, then worker:cpu/node pairs and the per-node worker counts, e.g.
+    // "compact | nodes=2 cpus=4 | workers 0:0/n0 1:1/n0 | per node n0=2 n1=0 | first-touch 12 MiB"
+    std::string report(Affinity mode) const {
+        std::lock_guard<std::mutex> lk(m_);
+        const Topology& topo = Topology::get();
+        std::ostringstream o;
+        o << (mode == Affinity::Compact ? "compact" : mode == Affinity::Scatter ? "scatter" : "none")
+          << " | nodes=" << topo.nodes() << " cpus=" << topo.cpus().size() << " | workers";
+        std::map<int, unsigned> per_node;
+        for (const CpuInfo& c : topo.cpus()) per_node[c.node];
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+            auto [cpu, pinned] = workers_[i];
+            if (cpu < 0) continue;
+            const CpuInfo* c = topo.find(cpu);
+            int node = c ? c->node : 0;
+            o << ' ' << i << ':' << cpu << "/n" << node << (pinned ? "" : "(unpinned)");
+            ++per_node[node];
+        }
+        o << " | per node";
+        for (auto [node, count] : per_node) o << " n" << node << '=' << count;
+        o << " | first-touch " << (first_touch_bytes_ >> 20) << " MiB";
+        return o.str();
+    }
+
+private:
+    mutable std::mutex m_;
+    std::vector<std::pair<int, bool>> workers_;  // (cpu, pinned)
+    std::size_t first_touch_bytes_ = 0;
+};
+
+// CPU for worker idx under mode, or -1 for none.
+#ifdef __linux__
+inline int planned_cpu(Affinity mode, unsigned idx) {
+    if (mode == Affinity::None) return -1;
+    static std::mutex m;
+    static std::map<Affinity, std::vector<CpuInfo>> orders;
+    std::lock_guard<std::mutex> lk(m);
+    auto it = orders.find(mode);
+    if (it == orders.end()) it = orders.emplace(mode, placement_order(Topology::get().cpus(), mode)).first;
+    if (it->second.empty()) return -1;
+    return it->second[idx % it->second.size()].cpu;
+}
+
+inline thread_local bool tls_affinity_saved = false;
+inline thread_local cpu_set_t tls_affinity_mask;
+
+// Pins the calling thread to worker idx's CPU until affinity_detach()
+// restores its previous mask; no-op for Affinity::None.
+inline void affinity_attach(Affinity mode, unsigned idx, bool log = true) {
+    int cpu = planned_cpu(mode, idx);
+    if (cpu < 0) return;
+    if (!tls_affinity_saved)
+        tls_affinity_saved = pthread_getaffinity_np(pthread_self(), sizeof(tls_affinity_mask), &tls_affinity_mask) == 0;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    bool pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    if (log) PlacementLog::get().record(idx, pinned ? sched_getcpu() : cpu, pinned);
+}
+
+inline void affinity_detach() {
+    if (!tls_affinity_saved) return;
+    pthread_setaffinity_np(pthread_self(), sizeof(tls_affinity_mask), &tls_affinity_mask);
+    tls_affinity_saved = false;
+}
+#else
+inline int planned_cpu(Affinity, unsigned) { return -1; }
+inline void affinity_attach(Affinity, unsigned, bool = true) {}
+inline void affinity_detach() {}
+#endif
+
+struct AffinityScope {
+    AffinityScope(Affinity mode, unsigned idx) { affinity_attach(mode, idx); }
+    ~AffinityScope() { affinity_detach(); }
+    AffinityScope(const AffinityScope&) = delete;
+    AffinityScope& operator=(const AffinityScope&) = delete;
+};
+
+// Zeroes words[0, n) from `threads` threads pinned as workers 0..threads-1,
+// thread i clearing the i-th equal share; for buffers that static slices
+// of a range fill in order.
+inline void first_touch_zero(std::uint64_t* words, std::size_t n, unsigned threads, Affinity mode) {
+    threads = std::max(1u, threads);
+    auto zero = [=](unsigned idx) {
+        std::size_t b = n / threads * idx + std::min<std::size_t>(idx, n % threads);
+        std::size_t e = b + n / threads + (idx < n % threads ? 1 : 0);
+        std::memset(words + b, 0, (e - b) * sizeof(std::uint64_t));
+    };
+    std::vector<std::thread> touch;
+    for (unsigned i = 1; i < threads; ++i)
+        touch.emplace_back([=]{ affinity_attach(mode, i, false); zero(i); });
+    affinity_attach(mode, 0, false);
+    zero(0);
+    affinity_detach();
+    for (auto& th : touch) th.join();
+    PlacementLog::get().first_touch(n * sizeof(std::uint64_t));
+}
+
+#endif
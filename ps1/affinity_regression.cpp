@@ -0,0 +1,63 @@
+#include "kernels.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+// Placement orders on a synthetic two-socket machine with two hardware
+// threads per core, then a pinned, first-touched run of each kernel on
+// this machine against an unpinned one.
+int main() {
+    assert((parse_cpu_list("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    assert(parse_cpu_list("").empty());
+
+    // cpus 0-3 on node 0 and 4-7 on node 1; cpu c and c + 8 share a core
+    std::vector<CpuInfo> cpus;
+    for (int c = 0; c < 16; ++c) {
+        int phys = c % 8;
+        cpus.push_back({c, phys / 4, phys / 4, phys % 4});
+    }
+    auto cpu_list = [](const std::vector<CpuInfo>& order) {
+        std::vector<int> out;
+        for (const CpuInfo& c : order) out.push_back(c.cpu);
+        return out;
+    };
+    assert((cpu_list(placement_order(cpus, Affinity::Compact)) ==
+            std::vector<int>{0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15}));
+    assert((cpu_list(placement_order(cpus, Affinity::Scatter)) ==
+            std::vector<int>{0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15}));
+
+    const Topology& topo = Topology::get();
+    assert(!topo.cpus().empty());
+#ifdef __linux__
+    for (Affinity mode : {Affinity::Compact, Affinity::Scatter}) {
+        std::thread([&]{
+            affinity_attach(mode, 1);
+            assert(sched_getcpu() == planned_cpu(mode, 1));
+            affinity_detach();
+        }).join();
+    }
+#else
+    assert(planned_cpu(Affinity::Compact, 1) == -1);
+#endif
+
+    Config plain;
+    plain.threads = 3;
+    plain.start = 1000;
+    plain.limit = 3'000'000;
+    for (Kernel k : {Kernel::RangeSplit, Kernel::Sieve, Kernel::Cooperative}) {
+        PrimeSet want = collect_primes(k, plain);
+        for (Affinity mode : {Affinity::Compact, Affinity::Scatter}) {
+            Config cfg = plain;
+            cfg.affinity = mode;
+            PrimeSet got = collect_primes(k, cfg);
+            assert(got.count() == want.count());
+            for (std::uint64_t n = cfg.start; n <= cfg.limit; n += 97) assert(got.contains(n) == want.contains(n));
+        }
+    }
+    std::string report = PlacementLog::get().report(Affinity::Scatter);
+    assert(report.find("scatter") == 0);
+#ifdef __linux__
+    assert(report.find(" 2:") != std::string::npos);
+#endif
+    return 0;
+}
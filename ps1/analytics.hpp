@@ -0,0 +1,182 @@
+#ifndef analytics_hpp
+#define analytics_hpp
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Optional gap and constellation analytics (analytics=1), gathered in the
+// same pass that finds the primes. Every slice a kernel works on keeps a
+// GapSummary of its primes: counts, gap histogram and largest gap, plus its
+// first and last three primes. After the join the summaries are sorted by
+// slice start and folded left; each fold adds what only becomes visible
+// across the boundary (the gap between the two slices and any twin,
+// triplet or quadruplet that straddles it), so the result matches one
+// serial pass over the whole range however it was sliced.
+//
+// Constellations are counted on consecutive primes, which is exact for the
+// admissible patterns used here:
+//   twins        p, p+2
+//   triplets     p, p+2, p+6  and  p, p+4, p+6
+//   quadruplets  p, p+2, p+6, p+8
+struct GapSummary {
+    std::uint64_t count = 0;
+    std::uint64_t head[3] = {};  // first min(count, 3) primes
+    std::uint64_t tail[3] = {};  // last min(count, 3) primes, ascending
+    std::uint64_t twins = 0;
+    std::uint64_t triplets = 0;
+    std::uint64_t quadruplets = 0;
+    std::uint64_t max_gap = 0;
+    std::uint64_t max_gap_at = 0;      // prime that starts the first largest gap
+    std::vector<std::uint64_t> gaps;   // gaps[g / 2]: gaps of size g (only 2 -> 3 has g = 1)
+
+    void add(std::uint64_t p) {
+        const unsigned n = kept();
+        if (n) {
+            std::uint64_t w[4];
+            std::copy_n(tail, n, w);
+            w[n] = p;
+            tally_windows(w, n, n);
+            record_gap(tail[n - 1], p);
+        }
+        if (n < 3) {
+            head[n] = p;
+            tail[n] = p;
+        } else {
+            tail[0] = tail[1];
+            tail[1] = tail[2];
+            tail[2] = p;
+        }
+        ++count;
+    }
+
+    // Appends a summary of primes that all lie above this one's.
+    void append(const GapSummary& b) {
+        if (b.count == 0) return;
+        if (count == 0) { *this = b; return; }
+        const unsigned na = kept(), nb = b.kept();
+        std::uint64_t s[6];
+        std::copy_n(tail, na, s);
+        std::copy_n(b.head, nb, s + na);
+        for (unsigned j = 0; j < nb; ++j) tally_windows(s, na + j, na);
+        record_gap(s[na - 1], s[na]);
+        twins += b.twins;
+        triplets += b.triplets;
+        quadruplets += b.quadruplets;
+        if (b.max_gap > max_gap) { max_gap = b.max_gap; max_gap_at = b.max_gap_at; }
+        if (gaps.size() < b.gaps.size()) gaps.resize(b.gaps.size());
+        for (std::size_t i = 0; i < b.gaps.size(); ++i) gaps[i] += b.gaps[i];
+
+        for (unsigned i = na; i < 3 && i - na < nb; ++i) head[i] = b.head[i - na];
+        std::uint64_t t[6];
+        std::copy_n(tail, na, t);
+        std::copy_n(b.tail, nb, t + na);
+        const unsigned nt = std::min(3u, na + nb);
+        std::copy_n(t + na + nb - nt, nt, tail);
+        count += b.count;
+    }
+
+private:
+    unsigned kept() const noexcept { return static_cast<unsigned>(std::min<std::uint64_t>(count, 3)); }
+
+    void record_gap(std::uint64_t a, std::uint64_t b) {
+        std::uint64_t g = b - a;
+        if (gaps.size() <= g / 2) gaps.resize(g / 2 + 1);
+        ++gaps[g / 2];
+        if (g > max_gap) { max_gap = g; max_gap_at = a; }
+    }
+
+    // Counts the windows of s that end at s[end] and start before s[first_new]
+    // (so windows wholly past the boundary, already counted, are skipped).
+    void tally_windows(const std::uint64_t* s, unsigned end, unsigned first_new) {
+        std::uint64_t g1 = s[end] - s[end - 1];
+        if (end - 1 < first_new && g1 == 2) ++twins;
+        if (end < 2) return;
+        std::uint64_t g2 = s[end - 1] - s[end - 2];
+        if (end - 2 < first_new && ((g2 == 2 && g1 == 4) || (g2 == 4 && g1 == 2))) ++triplets;
+        if (end < 3) return;
+        if (end - 3 < first_new && g1 == 2 && g2 == 4 && s[end - 2] - s[end - 3] == 2) ++quadruplets;
+    }
+};
+
+class RunAnalytics {
+public:
+    static RunAnalytics& get() {
+        static RunAnalytics a;
+        return a;
+    }
+
+    void enable() { enabled_ = true; }
+    bool enabled() const noexcept { return enabled_; }
+
+    void submit(std::uint64_t begin, GapSummary s) {
+        if (s.count == 0) return;
+        std::lock_guard<std::mutex> lk(m_);
+        slices_.emplace_back(begin, std::move(s));
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lk(m_);
+        slices_.clear();
+    }
+
+    std::size_t slices() const {
+        std::lock_guard<std::mutex> lk(m_);
+        return slices_.size();
+    }
+
+    // Every submitted slice stitched in ascending order.
+    GapSummary total() const {
+        std::lock_guard<std::mutex> lk(m_);
+        std::vector<const std::pair<std::uint64_t, GapSummary>*> order;
+        for (const auto& s : slices_) order.push_back(&s);
+        std::sort(order.begin(), order.end(), [](auto* a, auto* b){ return a->first < b->first; });
+        GapSummary all;
+        for (auto* s : order) all.append(s->second);
+        return all;
+    }
+
+    // "primes=78498 twins=8169 triplets=2837 quadruplets=166 max_gap=114@492113 slices=4 | gaps 1:1 2:8169 4:8143 ..."
+    std::string report() const {
+        GapSummary all = total();
+        std::ostringstream o;
+        o << "primes=" << all.count << " twins=" << all.twins << " triplets=" << all.triplets
+          << " quadruplets=" << all.quadruplets << " max_gap=" << all.max_gap << '@' << all.max_gap_at
+          << " slices=" << slices() << " | gaps";
+        for (std::size_t i = 0; i < all.gaps.size(); ++i)
+            if (all.gaps[i]) o << ' ' << (i ? 2 * i : 1) << ':' << all.gaps[i];
+        return o.str();
+    }
+
+private:
+    bool enabled_ = false;
+    mutable std::mutex m_;
+    std::vector<std::pair<std::uint64_t, GapSummary>> slices_;
+};
+
+// Summary of one slice's primes, passed in ascending order; submitted when
+// the scope ends. add() is a single branch when analytics are off.
+class AnalyticsSlice {
+public:
+    explicit AnalyticsSlice(std::uint64_t begin) : on_(RunAnalytics::get().enabled()), begin_(begin) {}
+    ~AnalyticsSlice() {
+        if (on_) RunAnalytics::get().submit(begin_, std::move(sum_));
+    }
+    AnalyticsSlice(const AnalyticsSlice&) = delete;
+    AnalyticsSlice& operator=(const AnalyticsSlice&) = delete;
+
+    void add(std::uint64_t p) {
+        if (on_) sum_.add(p);
+    }
+
+private:
+    bool on_;
+    std::uint64_t begin_;
+    GapSummary sum_;
+};
+
+#endif
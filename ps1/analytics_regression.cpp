@@ -0,0 +1,88 @@
+#include "kernels.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <random>
+
+namespace {
+
+GapSummary serial(std::uint64_t lo, std::uint64_t hi) {
+    GapSummary s;
+    std::vector<std::uint8_t> seg;
+    for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t p){ s.add(p); });
+    return s;
+}
+
+void check_same(const GapSummary& a, const GapSummary& b) {
+    assert(a.count == b.count);
+    assert(a.twins == b.twins && a.triplets == b.triplets && a.quadruplets == b.quadruplets);
+    assert(a.max_gap == b.max_gap && a.max_gap_at == b.max_gap_at);
+    assert(a.gaps == b.gaps);
+    assert(std::equal(a.tail, a.tail + 3, b.tail) && std::equal(a.head, a.head + 3, b.head));
+}
+
+// Counts by definition, from a plain primality table.
+void check_definitions(std::uint64_t hi) {
+    std::vector<bool> prime(hi + 9);
+    for (std::uint64_t n = 0; n < prime.size(); ++n) prime[n] = is_prime_single(n);
+    std::uint64_t twins = 0, triplets = 0, quads = 0;
+    for (std::uint64_t p = 5; p <= hi; ++p) {
+        if (!prime[p]) continue;
+        if (p + 2 <= hi && prime[p + 2]) ++twins;
+        if (p + 6 <= hi && prime[p + 6] && (prime[p + 2] || prime[p + 4])) ++triplets;
+        if (p + 8 <= hi && prime[p + 2] && prime[p + 6] && prime[p + 8]) ++quads;
+    }
+    GapSummary s = serial(2, hi);
+    assert(s.twins == twins + 1);  // (3, 5)
+    assert(s.triplets == triplets && s.quadruplets == quads);
+}
+
+}
+
+int main() {
+    GapSummary ref = serial(2, 1'000'000);
+    assert(ref.count == 78498 && ref.twins == 8169 && ref.quadruplets == 166);
+    assert(ref.max_gap == 114 && ref.max_gap_at == 492113);
+    assert(ref.gaps[0] == 1 && ref.gaps[1] == 8169);
+    check_definitions(300'000);
+
+    // any split of the primes into consecutive runs stitches back exactly,
+    // including runs of zero, one or two primes
+    std::vector<std::uint64_t> all;
+    std::vector<std::uint8_t> seg;
+    for_each_prime(2, 200'000, sieve_base_primes(200'000), seg, [&](std::uint64_t p){ all.push_back(p); });
+    GapSummary whole;
+    for (std::uint64_t p : all) whole.add(p);
+    std::mt19937_64 rng(18);
+    for (int round = 0; round < 50; ++round) {
+        GapSummary joined;
+        for (std::size_t i = 0; i < all.size(); ) {
+            std::size_t n = round % 2 ? rng() % 5 : rng() % 400;
+            GapSummary part;
+            for (std::size_t e = std::min(all.size(), i + n); i < e; ++i) part.add(all[i]);
+            joined.append(part);
+        }
+        check_same(joined, whole);
+    }
+
+    // the kernels' per-slice summaries, in static and dynamic schedules
+    RunAnalytics::get().enable();
+    Config plain;
+    plain.threads = 4;
+    plain.start = 1000;
+    plain.limit = 3'000'000;
+    GapSummary want = serial(plain.start, plain.limit);
+    for (Kernel k : {Kernel::RangeSplit, Kernel::Sieve, Kernel::Cooperative}) {
+        for (Schedule sched : {Schedule::Static, Schedule::Dynamic}) {
+            Config cfg = plain;
+            cfg.schedule = sched;
+            cfg.chunk = 997;
+            cfg.test = PrimalityTest::MillerRabin;
+            RunAnalytics::get().clear();
+            collect_primes(k, cfg);
+            check_same(RunAnalytics::get().total(), want);
+        }
+    }
+    RunAnalytics::get().clear();
+    return 0;
+}
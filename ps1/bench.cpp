@@ -0,0 +1,266 @@
+#include "count.hpp"
+#include "kernels.hpp"
+#include "output.hpp"
+#include "primefile.hpp"
+
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <unistd.h>
+
+// Benchmark driver: runs the variant kernels in-process over a sweep of
+// thread counts and limits and reports compute time, output time,
+// throughput, speedup and parallel efficiency as CSV or JSON.
+//
+//   ./bench [--variants=1,2,3,4,5,count] [--threads=1,2,4] [--limits=1e5,1e6]
+//           [--warmup=1] [--reps=3] [--format=csv|json] [--out=FILE]
+//           [--config=config.txt] [--baseline=old.csv] [--tolerance=0.10]
+//
+// Other keys (schedule, chunk, test, coop_cutoff, start, ...) come from
+// --config. Compute time runs the kernel with a sink that only counts.
+// Output time is what the variant's own output path adds on top, written
+// to /dev/null: the extra time of a full run for v1/v3, which print while
+// computing, and the PrimeSink pass for v2/v4/v5. --baseline compares
+// median compute time against an earlier CSV and exits 1 on regressions.
+namespace {
+
+struct VariantSpec {
+    std::string name;
+    Kernel kernel;
+    bool immediate;  // prints while computing (v1/v3)
+    bool count_only;
+};
+
+struct Row {
+    std::string variant;
+    std::uint64_t limit = 0;
+    unsigned threads = 0;
+    std::size_t primes = 0;
+    double compute_ms_median = 0, compute_ms_min = 0, output_ms_median = 0;
+    double throughput = 0, speedup = 0, efficiency = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+double median(std::vector<double> v) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    std::size_t m = v.size() / 2;
+    return v.size() % 2 ? v[m] : (v[m - 1] + v[m]) / 2;
+}
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    for (std::string item; std::getline(ss, item, sep);) if (!item.empty()) out.push_back(item);
+    return out;
+}
+
+std::optional<VariantSpec> find_variant(const std::string& v) {
+    if (v == "1" || v == "v1") return VariantSpec{"v1", Kernel::RangeSplit, true, false};
+    if (v == "2" || v == "v2") return VariantSpec{"v2", Kernel::RangeSplit, false, false};
+    if (v == "3" || v == "v3") return VariantSpec{"v3", Kernel::Cooperative, true, false};
+    if (v == "4" || v == "v4") return VariantSpec{"v4", Kernel::Cooperative, false, false};
+    if (v == "5" || v == "v5") return VariantSpec{"v5", Kernel::Sieve, false, false};
+    if (v == "count") return VariantSpec{"count", Kernel::Sieve, false, true};
+    return std::nullopt;
+}
+
+// One timed repetition: returns {primes, compute ms, output ms}.
+struct Sample { std::size_t primes; double compute_ms; double output_ms; };
+
+Sample run_once(const VariantSpec& v, const Config& cfg, int devnull) {
+    if (v.count_only) {
+        auto t0 = Clock::now();
+        ForkJoinPool pool(cfg.threads);
+        std::uint64_t n = prime_pi(cfg.limit, pool);
+        if (cfg.start > 2) n -= prime_pi(cfg.start - 1, pool);
+        return {static_cast<std::size_t>(n), ms_since(t0), 0};
+    }
+    if (v.immediate) {
+        auto t0 = Clock::now();
+        std::size_t n = run_kernel(v.kernel, cfg, [](std::uint64_t, unsigned){});
+        double compute = ms_since(t0);
+
+        t0 = Clock::now();
+        {
+            OutputPipeline output(cfg.print, devnull);
+            std::vector<std::unique_ptr<LineWriter>> writers;
+            for (unsigned i = 0; i < std::max(1u, cfg.threads); ++i) writers.push_back(std::make_unique<LineWriter>(output));
+            run_kernel(v.kernel, cfg, [&](std::uint64_t p, unsigned idx){ writers[idx]->prime(p); });
+        }
+        double total = ms_since(t0);
+        return {n, compute, std::max(0.0, total - compute)};
+    }
+    auto t0 = Clock::now();
+    PrimeSet primes = collect_primes(v.kernel, cfg);
+    double compute = ms_since(t0);
+    t0 = Clock::now();
+    {
+        PrimeSink sink(cfg);
+        primes.for_each([&](std::uint64_t p){ sink.push(p); });
+        std::cout.flush();
+        sink.close();
+    }
+    return {static_cast<std::size_t>(primes.count()), compute, ms_since(t0)};
+}
+
+void write_csv(std::ostream& os, const std::vector<Row>& rows) {
+    os << "variant,limit,threads,primes,compute_ms_median,compute_ms_min,output_ms_median,"
+          "throughput_per_s,speedup,efficiency\n";
+    for (const auto& r : rows) {
+        os << r.variant << ',' << r.limit << ',' << r.threads << ',' << r.primes << ','
+           << r.compute_ms_median << ',' << r.compute_ms_min << ',' << r.output_ms_median << ','
+           << r.throughput << ',' << r.speedup << ',' << r.efficiency << '\n';
+    }
+}
+
+void write_json(std::ostream& os, const std::vector<Row>& rows) {
+    os << "[\n";
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        const auto& r = rows[i];
+        os << "  {\"variant\":\"" << r.variant << "\",\"limit\":" << r.limit
+           << ",\"threads\":" << r.threads << ",\"primes\":" << r.primes
+           << ",\"compute_ms_median\":" << r.compute_ms_median
+           << ",\"compute_ms_min\":" << r.compute_ms_min
+           << ",\"output_ms_median\":" << r.output_ms_median
+           << ",\"throughput_per_s\":" << r.throughput
+           << ",\"speedup\":" << r.speedup
+           << ",\"efficiency\":" << r.efficiency << '}' << (i + 1 < rows.size() ? "," : "") << '\n';
+    }
+    os << "]\n";
+}
+
+// Reads variant,limit,threads -> compute_ms_median from an earlier CSV run.
+std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> out;
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);  // header
+    while (std::getline(in, line)) {
+        auto f = split(line, ',');
+        if (f.size() < 5) continue;
+        try { out[f[0] + "," + f[1] + "," + f[2]] = std::stod(f[4]); } catch (...) {}
+    }
+    return out;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> variant_names = {"1", "2", "3", "4", "5"};
+    std::vector<unsigned> thread_counts;
+    std::vector<std::uint64_t> limits = {100000, 1000000};
+    int warmup = 1, reps = 3;
+    std::string format = "csv", out_path, config_path = "config.txt", baseline_path;
+    double tolerance = 0.10;
+
+    for (unsigned t = 1; t <= std::max(1u, std::thread::hardware_concurrency()); t *= 2) thread_counts.push_back(t);
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto eq = a.find('=');
+        std::string key = a.substr(0, eq), val = eq == std::string::npos ? "" : a.substr(eq + 1);
+        try {
+            if (key == "--variants") variant_names = split(val, ',');
+            else if (key == "--threads") { thread_counts.clear(); for (auto& t : split(val, ',')) thread_counts.push_back(static_cast<unsigned>(std::stoul(t))); }
+            else if (key == "--limits") { limits.clear(); for (auto& l : split(val, ',')) limits.push_back(static_cast<std::uint64_t>(std::stold(l))); }
+            else if (key == "--warmup") warmup = std::stoi(val);
+            else if (key == "--reps") reps = std::max(1, std::stoi(val));
+            else if (key == "--format") format = val;
+            else if (key == "--out") out_path = val;
+            else if (key == "--config") config_path = val;
+            else if (key == "--baseline") baseline_path = val;
+            else if (key == "--tolerance") tolerance = std::stod(val);
+            else { std::cerr << "unknown option " << a << '\n'; return 2; }
+        } catch (...) {
+            std::cerr << "bad value for " << key << '\n';
+            return 2;
+        }
+    }
+
+    Config base_cfg = read_config_file(config_path).value_or(Config{});
+    base_cfg.mode = RunMode::Enumerate;
+    base_cfg.print = PrintMode::Buffered;
+    base_cfg.outfile = "/dev/null";
+    base_cfg.cache.clear();  // time the kernels, not cache hits
+
+    int devnull = ::open("/dev/null", O_WRONLY);
+    std::ofstream null_stream("/dev/null");
+    auto* saved_cout = std::cout.rdbuf(null_stream.rdbuf());  // PrimeSink's text path
+
+    std::vector<Row> rows;
+    std::map<std::uint64_t, std::size_t> primes_by_limit;
+    for (const auto& name : variant_names) {
+        auto v = find_variant(name);
+        if (!v) { std::cerr << "unknown variant " << name << '\n'; return 2; }
+        for (auto limit : limits) {
+            double base_ms = 0;
+            unsigned base_threads = 0;
+            for (unsigned threads : thread_counts) {
+                Config cfg = base_cfg;
+                cfg.limit = std::max<std::uint64_t>(limit, 2);
+                cfg.threads = std::max(1u, threads);
+                if (cfg.start > cfg.limit) cfg.start = 2;
+
+                for (int w = 0; w < warmup; ++w) run_once(*v, cfg, devnull);
+                std::vector<double> compute, output;
+                Row row;
+                for (int r = 0; r < reps; ++r) {
+                    Sample s = run_once(*v, cfg, devnull);
+                    compute.push_back(s.compute_ms);
+                    output.push_back(s.output_ms);
+                    row.primes = s.primes;
+                }
+                row.variant = v->name;
+                row.limit = cfg.limit;
+                row.threads = cfg.threads;
+                row.compute_ms_median = median(compute);
+                row.compute_ms_min = *std::min_element(compute.begin(), compute.end());
+                row.output_ms_median = median(output);
+                double numbers = static_cast<double>(cfg.limit - cfg.start + 1);
+                row.throughput = row.compute_ms_median > 0 ? numbers / (row.compute_ms_median / 1000.0) : 0;
+                if (base_threads == 0) { base_threads = cfg.threads; base_ms = row.compute_ms_median; }
+                row.speedup = row.compute_ms_median > 0 ? base_ms / row.compute_ms_median : 0;
+                row.efficiency = row.speedup * base_threads / cfg.threads;
+
+                auto [it, fresh] = primes_by_limit.emplace(cfg.limit, row.primes);
+                if (!fresh && it->second != row.primes)
+                    std::cerr << "[WARNING] " << v->name << " found " << row.primes << " primes at limit="
+                              << cfg.limit << ", expected " << it->second << '\n';
+                std::cerr << "[BENCH] " << v->name << " limit=" << cfg.limit << " threads=" << cfg.threads
+                          << " compute=" << row.compute_ms_median << " ms output=" << row.output_ms_median << " ms\n";
+                rows.push_back(row);
+            }
+        }
+    }
+    std::cout.rdbuf(saved_cout);
+    ::close(devnull);
+
+    std::ofstream file;
+    if (!out_path.empty()) file.open(out_path);
+    std::ostream& os = out_path.empty() ? std::cout : file;
+    if (format == "json") write_json(os, rows);
+    else write_csv(os, rows);
+
+    int status = 0;
+    if (!baseline_path.empty()) {
+        auto baseline = read_baseline(baseline_path);
+        for (const auto& r : rows) {
+            auto it = baseline.find(r.variant + "," + std::to_string(r.limit) + "," + std::to_string(r.threads));
+            if (it == baseline.end() || it->second <= 0) continue;
+            double change = r.compute_ms_median / it->second - 1.0;
+            if (change > tolerance) {
+                std::cerr << "[REGRESSION] " << r.variant << " limit=" << r.limit << " threads=" << r.threads
+                          << " compute " << it->second << " -> " << r.compute_ms_median << " ms (+"
+                          << static_cast<int>(change * 100) << "%)\n";
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
@@ -0,0 +1,219 @@
+#ifndef cache_hpp
+#define cache_hpp
+
+#include "primeset.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Persistent prime cache (cache=path), little-endian:
+//   header    PrimeCacheHeader (64 bytes)
+//   segments  segment i covers [i * S, (i + 1) * S - 1], S = 240 * 4096:
+//             {hi, checksum} then 4096 mod-30 wheel words laid out as in a
+//             PrimeSet starting at 0 (2, 3 and 5 are implied)
+// Every segment is full except possibly the last, whose hi is the header's
+// covered bound: all primes <= covered are in the file. Runs load the
+// cached prefix of their range word by word, compute only the tail, and
+// append it. Checksums are verified for the segments a run reads; a bad
+// segment truncates the cache there and the rest is recomputed. Writes go
+// through a shared mapping without fsync, so a crash can at worst leave a
+// segment that fails its checksum. The file is flock()ed while open.
+
+constexpr char kPrimeCacheMagic[8] = {'P', 'R', 'I', 'M', 'E', 'C', 'A', 'C'};
+constexpr std::uint32_t kPrimeCacheVersion = 1;
+constexpr std::size_t kCacheSegmentWords = 4096;
+constexpr std::uint64_t kCacheSegmentSpan = kCacheSegmentWords * 240;
+
+struct PrimeCacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t segment_words;
+    std::uint64_t segments;
+    std::uint64_t covered;
+    std::uint64_t reserved[4];
+};
+static_assert(sizeof(PrimeCacheHeader) == 64);
+
+struct PrimeCacheSegment {
+    std::uint64_t hi;
+    std::uint64_t checksum;
+    std::uint64_t words[kCacheSegmentWords];
+};
+
+// Four interleaved multiply-rotate lanes, so hashing runs near memory speed.
+inline std::uint64_t cache_checksum(std::uint64_t hi, const std::uint64_t* w, std::size_t n) {
+    constexpr std::uint64_t kMul = 0x9e3779b97f4a7c15ull;
+    std::uint64_t h[4] = {hi, hi ^ 0x243f6a8885a308d3ull, hi + kMul, ~hi};
+    for (std::size_t i = 0; i + 4 <= n; i += 4)
+        for (int j = 0; j < 4; ++j) h[j] = std::rotl((h[j] ^ w[i + j]) * kMul, 31);
+    std::uint64_t r = n;
+    for (int j = 0; j < 4; ++j) r = std::rotl((r ^ h[j]) * kMul, 27);
+    return r ^ (r >> 29);
+}
+
+class PrimeCache {
+public:
+    explicit PrimeCache(const std::string& path) : path_(path) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) { warn("cannot open"); return; }
+        ::flock(fd_, LOCK_EX);
+        struct stat st{};
+        ::fstat(fd_, &st);
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        PrimeCacheHeader h{};
+        bool valid = size >= sizeof(h) && ::pread(fd_, &h, sizeof(h), 0) == static_cast<ssize_t>(sizeof(h)) &&
+                     std::memcmp(h.magic, kPrimeCacheMagic, sizeof(h.magic)) == 0 &&
+                     h.version == kPrimeCacheVersion && h.segment_words == kCacheSegmentWords &&
+                     h.segments <= (size - sizeof(h)) / sizeof(PrimeCacheSegment) &&
+                     (h.segments == 0 ? h.covered == 1
+                                      : h.covered >= (h.segments - 1) * kCacheSegmentSpan &&
+                                        h.covered <= h.segments * kCacheSegmentSpan - 1);
+        if (!valid) {
+            if (size != 0) warn("has an unknown layout; starting over");
+            h = PrimeCacheHeader{};
+            std::memcpy(h.magic, kPrimeCacheMagic, sizeof(h.magic));
+            h.version = kPrimeCacheVersion;
+            h.segment_words = kCacheSegmentWords;
+            h.covered = 1;
+        }
+        if (!map(h.segments)) return;
+        *header() = h;
+    }
+
+    ~PrimeCache() {
+        if (base_) ::munmap(base_, len_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    PrimeCache(const PrimeCache&) = delete;
+    PrimeCache& operator=(const PrimeCache&) = delete;
+
+    bool ok() const noexcept { return base_ != nullptr; }
+    std::uint64_t covered() const noexcept { return ok() ? header()->covered : 0; }
+
+    // Checks every segment holding numbers <= upto and truncates the cache
+    // at the first bad one. Returns the (possibly reduced) covered bound.
+    std::uint64_t verify(std::uint64_t upto) {
+        if (!ok()) return 0;
+        PrimeCacheHeader* h = header();
+        std::uint64_t need = std::min(h->segments, upto / kCacheSegmentSpan + 1);
+        for (; verified_ < need; ++verified_) {
+            const PrimeCacheSegment& s = segment(verified_);
+            std::uint64_t seg_end = (verified_ + 1) * kCacheSegmentSpan - 1;
+            bool last = verified_ + 1 == h->segments;
+            bool bounds = last ? s.hi == h->covered && s.hi <= seg_end && s.hi >= verified_ * kCacheSegmentSpan
+                               : s.hi == seg_end;
+            if (bounds && s.checksum == cache_checksum(s.hi, s.words, kCacheSegmentWords)) continue;
+            h->segments = verified_;
+            h->covered = verified_ ? verified_ * kCacheSegmentSpan - 1 : 1;
+            warn("segment " + std::to_string(verified_) + " failed its checksum; recomputing from " +
+                 std::to_string(verified_ * kCacheSegmentSpan));
+            break;
+        }
+        return h->covered;
+    }
+
+    // Fills set with the cached primes in its range and returns the first
+    // number that still has to be computed (set.hi() + 1 when fully cached).
+    std::uint64_t load_into(PrimeSet& set) {
+        std::uint64_t c = verify(set.hi());
+        if (set.lo() > c) return set.lo();
+        std::uint64_t top = std::min(set.hi(), c);
+        for (std::uint64_t p : {2u, 3u, 5u})
+            if (p >= set.lo() && p <= top) set.insert(p);
+        for (std::uint64_t i = set.lo() / kCacheSegmentSpan; i <= top / kCacheSegmentSpan; ++i)
+            set.merge_wheel_words(i * kCacheSegmentSpan, segment(i).words, kCacheSegmentWords);
+        return top + 1;
+    }
+
+    // Calls fn(p) for every cached prime in [lo, hi] in ascending order.
+    // Returns the first number not covered (hi + 1 when fully cached).
+    template <class Fn>
+    std::uint64_t for_each(std::uint64_t lo, std::uint64_t hi, Fn&& fn) {
+        std::uint64_t c = verify(hi);
+        if (lo > c) return lo;
+        std::uint64_t top = std::min(hi, c);
+        for (std::uint64_t p : {2u, 3u, 5u})
+            if (p >= lo && p <= top) fn(p);
+        for (std::uint64_t i = lo / kCacheSegmentSpan; i <= top / kCacheSegmentSpan; ++i) {
+            const std::uint64_t* w = segment(i).words;
+            std::uint64_t first = i * kCacheSegmentSpan;
+            for (std::size_t j = 0; j < kCacheSegmentWords; ++j) {
+                for (std::uint64_t word = w[j]; word; word &= word - 1) {
+                    unsigned b = static_cast<unsigned>(std::countr_zero(word));
+                    std::uint64_t p = first + (j * 8 + b / 8) * 30 + PrimeSet::kResidues[b % 8];
+                    if (p > top) return top + 1;
+                    if (p >= lo) fn(p);
+                }
+            }
+        }
+        return top + 1;
+    }
+
+    // Extends the cache to set.hi() from a set holding every prime in
+    // [set.lo(), set.hi()]. A no-op unless the set reaches back to the cached bound.
+    bool append(const PrimeSet& set) {
+        if (!ok()) return false;
+        std::uint64_t c = verify(set.hi());
+        if (set.hi() <= c || set.lo() > c + 1) return true;
+        PrimeCacheHeader h = *header();
+        std::uint64_t first = h.segments ? h.segments - 1 : 0;  // last segment may be partial
+        std::uint64_t segments = set.hi() / kCacheSegmentSpan + 1;
+        if (!map(segments)) return false;
+
+        std::vector<std::uint64_t> words(kCacheSegmentWords);
+        for (std::uint64_t i = first; i < segments; ++i) {
+            PrimeCacheSegment& s = segment(i);
+            if (i >= h.segments) std::memset(s.words, 0, sizeof(s.words));
+            set.copy_wheel_words(i * kCacheSegmentSpan, words.data(), kCacheSegmentWords);
+            for (std::size_t j = 0; j < kCacheSegmentWords; ++j) s.words[j] |= words[j];
+            s.hi = std::min(set.hi(), (i + 1) * kCacheSegmentSpan - 1);
+            s.checksum = cache_checksum(s.hi, s.words, kCacheSegmentWords);
+        }
+        h.segments = segments;
+        h.covered = set.hi();
+        *header() = h;
+        verified_ = segments;
+        return true;
+    }
+
+private:
+    PrimeCacheHeader* header() const noexcept { return reinterpret_cast<PrimeCacheHeader*>(base_); }
+    PrimeCacheSegment& segment(std::uint64_t i) const noexcept {
+        return reinterpret_cast<PrimeCacheSegment*>(base_ + sizeof(PrimeCacheHeader))[i];
+    }
+
+    // (Re)maps the file sized for the given number of segments.
+    bool map(std::uint64_t segments) {
+        std::size_t len = sizeof(PrimeCacheHeader) + static_cast<std::size_t>(segments) * sizeof(PrimeCacheSegment);
+        if (base_ && len == len_) return true;
+        PrimeCacheHeader saved{};
+        if (base_) { saved = *header(); ::munmap(base_, len_); base_ = nullptr; }
+        struct stat st{};
+        ::fstat(fd_, &st);
+        if (static_cast<std::size_t>(st.st_size) < len && ::ftruncate(fd_, static_cast<off_t>(len)) != 0) {
+            warn("cannot grow");
+            return false;
+        }
+        void* m = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (m == MAP_FAILED) { warn("mmap failed"); return false; }
+        base_ = static_cast<std::uint8_t*>(m);
+        len_ = len;
+        if (saved.version) *header() = saved;
+        return true;
+    }
+
+    void warn(const std::string& what) const { print_line("[WARNING] cache " + path_ + " " + what + "."); }
+
+    std::string path_;
+    int fd_ = -1;
+    std::uint8_t* base_ = nullptr;
+    std::size_t len_ = 0;
+    std::uint64_t verified_ = 0;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "kernels.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Grows a cache over several runs with unaligned starts and limits and
+// checks every run against an uncached sieve, then corrupts a segment and
+// checks that it is recomputed, and corrupts the header's bounds and checks
+// that the file is discarded.
+namespace {
+
+std::vector<std::uint64_t> primes_of(const PrimeSet& s) {
+    std::vector<std::uint64_t> out;
+    s.for_each([&](std::uint64_t p){ out.push_back(p); });
+    return out;
+}
+
+std::vector<std::uint64_t> reference(std::uint64_t lo, std::uint64_t hi) {
+    std::vector<std::uint64_t> out;
+    std::vector<std::uint8_t> seg;
+    for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t p){ out.push_back(p); });
+    return out;
+}
+
+}
+int main() {
+    const std::string path = "/tmp/cache_regression.bin";
+    std::remove(path.c_str());
+    Config cfg;
+    cfg.threads = 2;
+    cfg.cache = path;
+
+    struct Run { std::uint64_t start, limit; Kernel kernel; };
+    const Run runs[] = {
+        {2, 1000, Kernel::RangeSplit},
+        {2, 3 * kCacheSegmentSpan + 12345, Kernel::Sieve},
+        {777, 2 * kCacheSegmentSpan + 1, Kernel::Cooperative},          // fully cached
+        {kCacheSegmentSpan - 7, 4 * kCacheSegmentSpan, Kernel::Sieve},  // appends
+        {5 * kCacheSegmentSpan, 5 * kCacheSegmentSpan + 5000, Kernel::Sieve},  // gap: not appended
+        {3, 4 * kCacheSegmentSpan + 1, Kernel::RangeSplit},
+    };
+    for (const Run& r : runs) {
+        cfg.start = r.start;
+        cfg.limit = r.limit;
+        assert(primes_of(collect_primes(r.kernel, cfg)) == reference(r.start, r.limit));
+    }
+    assert(PrimeCache(path).covered() == 4 * kCacheSegmentSpan + 1);
+
+    std::vector<std::uint64_t> streamed;
+    PrimeCache(path).for_each(1000, 2 * kCacheSegmentSpan, [&](std::uint64_t p){ streamed.push_back(p); });
+    assert(streamed == reference(1000, 2 * kCacheSegmentSpan));
+
+    // flip one bit of segment 1: the cache falls back to segment 0's bound
+    std::FILE* f = std::fopen(path.c_str(), "r+b");
+    long at = static_cast<long>(sizeof(PrimeCacheHeader) + sizeof(PrimeCacheSegment) + 64);
+    std::fseek(f, at, SEEK_SET);
+    int b = std::fgetc(f);
+    std::fseek(f, at, SEEK_SET);
+    std::fputc(b ^ 4, f);
+    std::fclose(f);
+    {
+        PrimeCache c(path);
+        assert(c.verify(~std::uint64_t{0}) == kCacheSegmentSpan - 1);
+    }
+    cfg.start = 2;
+    cfg.limit = 3 * kCacheSegmentSpan;
+    assert(primes_of(collect_primes(Kernel::Sieve, cfg)) == reference(2, cfg.limit));
+    assert(PrimeCache(path).covered() == cfg.limit);
+
+    // a covered bound outside the segments present: the file is discarded
+    auto set_header = [&](std::uint64_t segments, std::uint64_t covered) {
+        std::FILE* hf = std::fopen(path.c_str(), "r+b");
+        std::fseek(hf, static_cast<long>(offsetof(PrimeCacheHeader, segments)), SEEK_SET);
+        std::fwrite(&segments, sizeof(segments), 1, hf);
+        std::fseek(hf, static_cast<long>(offsetof(PrimeCacheHeader, covered)), SEEK_SET);
+        std::fwrite(&covered, sizeof(covered), 1, hf);
+        std::fclose(hf);
+    };
+    set_header(0, 5'000'000);
+    assert(PrimeCache(path).covered() == 1);
+    cfg.limit = 2 * kCacheSegmentSpan;
+    assert(primes_of(collect_primes(Kernel::Sieve, cfg)) == reference(2, cfg.limit));
+    set_header(2, 5 * kCacheSegmentSpan);
+    assert(PrimeCache(path).covered() == 1);
+    set_header(0, 1);
+    assert(PrimeCache(path).covered() == 1);
+    assert(primes_of(collect_primes(Kernel::Sieve, cfg)) == reference(2, cfg.limit));
+    std::remove(path.c_str());
+    return 0;
+}
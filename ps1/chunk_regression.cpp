@@ -0,0 +1,99 @@
+#include "sieve.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+// Several threads race on one cursor; together the claimed chunks must tile
+// [start, start + total) exactly once, and each slot must map back to its chunk.
+void check_cursor(std::uint64_t start, std::uint64_t total,
+                  std::uint64_t chunk, unsigned int threads) {
+    Config cfg;
+    cfg.threads = threads;
+    cfg.schedule = Schedule::Dynamic;
+    cfg.chunk = chunk;
+    RangeScheduler sched(cfg, start, total);
+
+    std::vector<std::vector<std::pair<WorkerSlice, std::size_t>>> claimed(threads);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i]{
+            sched.run(i, [&](WorkerSlice slice, std::size_t slot){
+                claimed[i].emplace_back(slice, slot);
+            });
+        });
+    }
+    for (auto& th : workers) th.join();
+
+    std::vector<std::pair<WorkerSlice, std::size_t>> all;
+    for (auto& v : claimed) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end(), [](const auto& a, const auto& b){
+        return a.first.begin < b.first.begin;
+    });
+
+    assert(all.size() == sched.slots());
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < all.size(); ++i) {
+        const auto& [slice, slot] = all[i];
+        assert(slot == i);
+        assert(slice.count >= 1 && slice.count <= chunk);
+        assert(slice.begin == start + sum);
+        sum += slice.count;
+    }
+    assert(sum == total);
+}
+
+std::vector<std::uint64_t> primes_with(const Config& cfg) {
+    const std::uint64_t start = 2;
+    const std::uint64_t total = cfg.limit - start + 1;
+    RangeScheduler sched(cfg, start, total);
+    std::vector<std::vector<std::uint64_t>> buckets(sched.slots());
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < cfg.threads; ++i) {
+        workers.emplace_back([&, i]{
+            sched.run(i, [&](WorkerSlice slice, std::size_t slot){
+                for (std::uint64_t off = 0; off < slice.count; ++off)
+                    if (is_prime_single(slice.begin + off)) buckets[slot].push_back(slice.begin + off);
+            });
+        });
+    }
+    for (auto& th : workers) th.join();
+    std::vector<std::uint64_t> out;
+    for (auto& v : buckets) out.insert(out.end(), v.begin(), v.end());
+    return out;
+}
+
+// Dynamic scheduling must produce the same ordered output as static slicing.
+void check_identical_output(std::uint64_t limit, unsigned int threads, std::uint64_t chunk) {
+    Config st;
+    st.threads = threads;
+    st.limit = limit;
+    Config dyn = st;
+    dyn.schedule = Schedule::Dynamic;
+    dyn.chunk = chunk;
+
+    auto a = primes_with(st);
+    auto b = primes_with(dyn);
+    assert(std::is_sorted(b.begin(), b.end()));
+    assert(a == b);
+
+    std::vector<std::uint64_t> c;
+    std::vector<std::uint8_t> seg;
+    for_each_prime(2, limit, sieve_base_primes(limit), seg, [&](std::uint64_t p){ c.push_back(p); });
+    assert(a == c);
+}
+
+}
+int main() {
+    check_cursor(2, std::numeric_limits<std::uint64_t>::max() - 2, std::uint64_t{1} << 62, 8);
+    check_cursor(2, 999, 7, 4);
+    check_cursor(2, 1000, 1000, 3);
+    check_cursor(2, 5, 4096, 16);
+    check_cursor(0, 100000, 1, 4);
+    check_identical_output(20000, 4, 1);
+    check_identical_output(20000, 7, 333);
+    check_identical_output(100, 32, 4096);
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef count_hpp
+#define count_hpp
+
+#include "pool.hpp"
+
+// pi(x) by Lucy_Hedgehog's method in O(x^(3/4)) time and O(sqrt x) memory.
+// S(v) starts as v - 1 (all of 2..v) and each prime p <= sqrt x removes the
+// numbers whose least prime factor is p:
+//     S(v) -= S(v / p) - S(p - 1)    for every tracked v >= p^2
+// Only v = x / i (large[i]) and v <= sqrt x (small[v]) are ever needed.
+//
+// Every update for one p reads only values from before that p, so when the
+// round is big enough the new values are computed into scratch buffers by
+// the pool and then copied back; small rounds run serially in place.
+inline std::uint64_t prime_pi(std::uint64_t x, ForkJoinPool& pool) {
+    if (x < 2) return 0;
+    const std::uint64_t r = isqrt64(x);
+    std::vector<std::uint64_t> small(r + 1), large(r + 1);
+    for (std::uint64_t v = 1; v <= r; ++v) small[v] = v - 1;
+    for (std::uint64_t i = 1; i <= r; ++i) large[i] = x / i - 1;
+
+    constexpr std::uint64_t kParallelMin = 1u << 15;
+    std::vector<std::uint64_t> next_large, next_small;
+    const unsigned k = pool.size();
+
+    for (std::uint64_t p = 2; p <= r; ++p) {
+        if (small[p] == small[p - 1]) continue;
+        const std::uint64_t sp = small[p - 1];
+        const std::uint64_t p2 = p * p;
+        const std::uint64_t nl = std::min(r, x / p2);       // large[1..nl] change
+        const std::uint64_t ns = r >= p2 ? r - p2 + 1 : 0;  // small[p2..r] change
+
+        auto large_term = [&](std::uint64_t i) {
+            std::uint64_t d = i * p;
+            return (d <= r ? large[d] : small[x / d]) - sp;
+        };
+
+        if (k == 1 || nl + ns < kParallelMin) {
+            // ascending i reads large[i*p] before it is rewritten; descending v likewise
+            for (std::uint64_t i = 1; i <= nl; ++i) large[i] -= large_term(i);
+            for (std::uint64_t v = r; v >= p2; --v) small[v] -= small[v / p] - sp;
+            continue;
+        }
+
+        next_large.resize(nl);
+        next_small.resize(ns);
+        pool.run(k, [&](unsigned idx){
+            auto ls = compute_worker_slice(1, nl, k, idx);
+            for (std::uint64_t i = ls.begin; i < ls.begin + ls.count; ++i)
+                next_large[i - 1] = large[i] - large_term(i);
+            auto ss = compute_worker_slice(p2, ns, k, idx);
+            for (std::uint64_t v = ss.begin; v < ss.begin + ss.count; ++v)
+                next_small[v - p2] = small[v] - (small[v / p] - sp);
+        });
+        pool.run(k, [&](unsigned idx){
+            auto ls = compute_worker_slice(1, nl, k, idx);
+            if (ls.count) std::copy_n(next_large.begin() + (ls.begin - 1), ls.count, large.begin() + ls.begin);
+            auto ss = compute_worker_slice(p2, ns, k, idx);
+            if (ss.count) std::copy_n(next_small.begin() + (ss.begin - p2), ss.count, small.begin() + ss.begin);
+        });
+    }
+    return large[1];
+}
+
+inline std::uint64_t prime_pi(std::uint64_t x, unsigned int threads = 1) {
+    ForkJoinPool pool(threads);
+    return prime_pi(x, pool);
+}
+
+// mode=count: reports pi(limit) - pi(start - 1) without enumerating or printing primes.
+inline int run_count_mode(const char* title, const Config& cfg) {
+    print_line("[RUN START] " + now_timestamp());
+    auto t0 = std::chrono::steady_clock::now();
+    ForkJoinPool pool(cfg.threads);
+    if (cfg.affinity != Affinity::None) pool.run(pool.size(), [&](unsigned idx){ affinity_attach(cfg.affinity, idx); });
+    std::uint64_t primes = prime_pi(cfg.limit, pool);
+    if (cfg.start > 2) primes -= prime_pi(cfg.start - 1, pool);
+    if (cfg.affinity != Affinity::None) pool.run(pool.size(), [](unsigned){ affinity_detach(); });
+    auto t1 = std::chrono::steady_clock::now();
+    print_line("[RUN END] " + now_timestamp());
+    print_summary(title, cfg, t1 - t0, static_cast<std::size_t>(primes));
+    return 0;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include "count.hpp"
+#include "miller_rabin.hpp"
+#include "primeset.hpp"
+#include "sieve.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+namespace {
+
+// pi(x) from Lucy must agree with what the enumerating kernels find:
+// trial division (v1-v4), Miller-Rabin (test=mr) and the segmented sieve
+// into a PrimeSet (v5).
+void check_small(std::uint64_t limit, ForkJoinPool& pool) {
+    PrimeSet set(2, limit);
+    std::vector<std::uint8_t> seg;
+    for_each_prime(2, limit, sieve_base_primes(limit), seg, [&](std::uint64_t p){ set.insert(p); });
+    set.build_index();
+
+    std::uint64_t trial = 0, mr = 0;
+    for (std::uint64_t x = 0; x <= limit; ++x) {
+        if (is_prime_single(x)) ++trial;
+        if (is_prime_mr(x)) ++mr;
+        if (x % 97 == 0 || x == limit) {
+            std::uint64_t pi = prime_pi(x, pool);
+            assert(pi == trial);
+            assert(pi == mr);
+            assert(pi == set.rank(x));
+        }
+    }
+}
+
+// Windows, as mode=count computes them with start=.
+void check_window(std::uint64_t lo, std::uint64_t hi, ForkJoinPool& pool) {
+    std::uint64_t n = 0;
+    std::vector<std::uint8_t> seg;
+    for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t){ ++n; });
+    assert(prime_pi(hi, pool) - prime_pi(lo - 1, pool) == n);
+}
+
+}
+int main() {
+    ForkJoinPool serial(1);
+    ForkJoinPool parallel(4);
+    check_small(20'000, serial);
+    check_small(20'000, parallel);
+
+    // published values of pi(10^k)
+    const std::uint64_t known[] = {0, 4, 25, 168, 1229, 9592, 78498, 664579, 5761455,
+                                   50847534, 455052511, 4118054813ull, 37607912018ull};
+    for (unsigned e = 0; e < std::size(known); ++e) {
+        std::uint64_t x = 1;
+        for (unsigned i = 0; i < e; ++i) x *= 10;
+        assert(prime_pi(x, parallel) == known[e]);
+        if (e <= 10) assert(prime_pi(x, serial) == known[e]);
+    }
+
+    check_window(1'000'000, 3'000'000, parallel);
+    check_window(99'999'000'000ull, 100'000'000'000ull, parallel);
+    return 0;
+}
@@ -12,10 +12,16 @@
 #include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <ctime>
 #include <thread>
 #include <vector>
 #include <algorithm>
 
+#include "affinity.hpp"
+#include "analytics.hpp"
+#include "stats.hpp"
+
 
 struct WorkerSlice {
     std::uint64_t begin;
@@ -51,10 +57,117 @@ inline WorkerSlice compute_worker_slice(std::uint64_t start,
     return slice;
 }
 
+// compute_worker_slice over whole units of `align` numbers: every boundary
+// except the end of the range falls on start + a multiple of align, so
+// shards of a sieved range never split a segment.
+inline WorkerSlice compute_aligned_slice(std::uint64_t start,
+                                         std::uint64_t total,
+                                         unsigned int parts,
+                                         unsigned int idx,
+                                         std::uint64_t align) {
+    align = std::max<std::uint64_t>(align, 1);
+    std::uint64_t units = total / align + (total % align != 0);
+    WorkerSlice u = compute_worker_slice(0, units, parts, idx);
+    if (u.count == 0) return {start, 0};
+    std::uint64_t begin = u.begin * align;
+    std::uint64_t end = static_cast<std::uint64_t>(
+        std::min<__uint128_t>(total, static_cast<__uint128_t>(u.begin + u.count) * align));
+    return {start + begin, end - begin};
+}
+
+
+enum class RunMode { Enumerate, Count };
+enum class Schedule { Static, Dynamic };
+enum class PrimalityTest { Trial, MillerRabin };
+enum class PrintMode { Immediate, Buffered };
+enum class OutputFormat { Text, Binary };
 
 struct Config {
     unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
     std::uint64_t limit = 100000;
+    std::uint64_t start = 2;
+    RunMode mode = RunMode::Enumerate;
+    PrimalityTest test = PrimalityTest::Trial;
+    PrintMode print = PrintMode::Buffered;
+    OutputFormat format = OutputFormat::Text;
+    std::string outfile = "primes.pbin";
+    Schedule schedule = Schedule::Static;
+    std::uint64_t chunk = 4096;
+    std::uint64_t coop_cutoff = 2048;  // v3/v4: min candidate divisors before a number is split
+    std::string cache;                 // persistent prime cache file; empty = off
+    StatsMode stats = StatsMode::Off;
+    Affinity affinity = Affinity::None;
+    bool analytics = false;            // gap / twin / constellation counts (analytics.hpp)
+    std::uint64_t pi_max = 10'000'000'000'000;  // server: largest pi/nth bound counted past the resident set
+};
+
+// Shared atomic cursor over [start, start + total). Each claim hands out the
+// next `chunk` numbers, so fast threads keep pulling work while the thread
+// holding the expensive top of the range is still busy.
+class ChunkCursor {
+public:
+    ChunkCursor(std::uint64_t start, std::uint64_t total, std::uint64_t chunk)
+        : start_(start), total_(total), chunk_(std::max<std::uint64_t>(1, chunk)) {}
+
+    // Returns the next unclaimed chunk, or a slice with count == 0 once the
+    // range is exhausted. The CAS keeps the cursor from wrapping near 2^64.
+    WorkerSlice claim() {
+        std::uint64_t off = next_.load(std::memory_order_relaxed);
+        std::uint64_t step;
+        do {
+            if (off >= total_) return WorkerSlice{start_, 0};
+            step = std::min(chunk_, total_ - off);
+        } while (!next_.compare_exchange_weak(off, off + step, std::memory_order_relaxed));
+        return WorkerSlice{start_ + off, step};
+    }
+
+    std::uint64_t chunk() const noexcept { return chunk_; }
+
+private:
+    std::uint64_t start_;
+    std::uint64_t total_;
+    std::uint64_t chunk_;
+    std::atomic<std::uint64_t> next_{0};
+};
+
+// Hands each worker its share of [start, start + total) according to
+// cfg.schedule. Every slice comes with a slot index; slots are dense and
+// ordered by slice.begin, so per-slot result buffers concatenate in order.
+class RangeScheduler {
+public:
+    RangeScheduler(const Config& cfg, std::uint64_t start, std::uint64_t total,
+                   std::uint64_t chunk_multiple = 1)
+        : start_(start), total_(total), threads_(cfg.threads),
+          dynamic_(cfg.schedule == Schedule::Dynamic),
+          cursor_(start, total, round_up(cfg.chunk, chunk_multiple)) {}
+
+    std::size_t slots() const {
+        if (!dynamic_) return threads_;
+        return static_cast<std::size_t>(total_ / cursor_.chunk() + (total_ % cursor_.chunk() != 0));
+    }
+
+    template <class Fn>
+    void run(unsigned idx, Fn&& fn) {
+        if (!dynamic_) {
+            auto slice = compute_worker_slice(start_, total_, threads_, idx);
+            if (slice.count != 0) fn(slice, static_cast<std::size_t>(idx));
+            return;
+        }
+        for (auto slice = cursor_.claim(); slice.count != 0; slice = cursor_.claim())
+            fn(slice, static_cast<std::size_t>((slice.begin - start_) / cursor_.chunk()));
+    }
+
+private:
+    static std::uint64_t round_up(std::uint64_t chunk, std::uint64_t multiple) {
+        if (multiple <= 1) return chunk;
+        return std::max<std::uint64_t>(1, (chunk + multiple - 1) / multiple) * multiple;
+    }
+
+    std::uint64_t start_;
+    std::uint64_t total_;
+    unsigned int threads_;
+    bool dynamic_;
+    ChunkCursor cursor_;
 };
 
 inline std::mutex& cout_mutex() {
@@ -62,25 +175,45 @@ inline std::mutex& cout_mutex() {
     return m;
 }
 
-inline std::string now_timestamp() {
-    using namespace std::chrono;
-    auto now = system_clock::now();
-    auto tt = system_clock::to_time_t(now);
-    auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
-    std::tm tm{};
+// Formats "YYYY-MM-DD HH:MM:SS.mmm". localtime_r and strftime only run when
+// the wall-clock second changes; within a second only the millis are patched.
+class TimestampCache {
+public:
+    std::string_view now() {
+        using namespace std::chrono;
+        auto now = system_clock::now();
+        auto tt = system_clock::to_time_t(now);
+        auto ms = static_cast<unsigned>((duration_cast<milliseconds>(now.time_since_epoch()) % 1000).count());
+        if (tt != sec_) {
+            std::tm tm{};
 #ifdef _WIN32
-    localtime_s(&tm, &tt);
+            localtime_s(&tm, &tt);
 #else
-    localtime_r(&tt, &tm);
+            localtime_r(&tt, &tm);
 #endif
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S")
-        << '.' << std::setw(3) << std::setfill('0') << ms.count();
-    return oss.str();
+            len_ = std::strftime(buf_, sizeof(buf_) - 4, "%Y-%m-%d %H:%M:%S", &tm);
+            buf_[len_] = '.';
+            sec_ = tt;
+        }
+        buf_[len_ + 1] = static_cast<char>('0' + ms / 100);
+        buf_[len_ + 2] = static_cast<char>('0' + ms / 10 % 10);
+        buf_[len_ + 3] = static_cast<char>('0' + ms % 10);
+        return std::string_view(buf_, len_ + 4);
+    }
+
+private:
+    std::time_t sec_ = -1;
+    std::size_t len_ = 0;
+    char buf_[48] = {};
+};
+
+inline std::string now_timestamp() {
+    thread_local TimestampCache cache;
+    return std::string(cache.now());
 }
 
 inline void print_line(const std::string& s) {
-    std::lock_guard<std::mutex> lock(cout_mutex());
+    auto lock = timed_lock(cout_mutex());
     std::cout << s << '\n';
 }
 
@@ -111,6 +244,56 @@ inline std::optional<Config> read_config_file(const std::string& path) {
                 long double ld = std::stold(val);
                 if (ld >= 2 && ld <= 9.22e18L) cfg.limit = static_cast<std::uint64_t>(ld);
             } catch (...) {}
+        } else if (key == "start") {
+            try {
+                long double ld = std::stold(val);
+                if (ld >= 2 && ld <= 9.22e18L) cfg.start = static_cast<std::uint64_t>(ld);
+            } catch (...) {}
+        } else if (key == "mode") {
+            if (val == "enumerate") cfg.mode = RunMode::Enumerate;
+            else if (val == "count") cfg.mode = RunMode::Count;
+        } else if (key == "test") {
+            if (val == "trial") cfg.test = PrimalityTest::Trial;
+            else if (val == "mr" || val == "miller-rabin") cfg.test = PrimalityTest::MillerRabin;
+        } else if (key == "print") {
+            if (val == "immediate") cfg.print = PrintMode::Immediate;
+            else if (val == "buffered") cfg.print = PrintMode::Buffered;
+        } else if (key == "format") {
+            if (val == "text") cfg.format = OutputFormat::Text;
+            else if (val == "binary") cfg.format = OutputFormat::Binary;
+        } else if (key == "outfile") {
+            if (!val.empty()) cfg.outfile = val;
+        } else if (key == "schedule") {
+            if (val == "static") cfg.schedule = Schedule::Static;
+            else if (val == "dynamic") cfg.schedule = Schedule::Dynamic;
+        } else if (key == "chunk") {
+            try {
+                long double ld = std::stold(val);
+                if (ld >= 1 && ld <= 1e15L) cfg.chunk = static_cast<std::uint64_t>(ld);
+            } catch (...) {}
+        } else if (key == "coop_cutoff") {
+            try {
+                long double ld = std::stold(val);
+                if (ld >= 0 && ld <= 1e15L) cfg.coop_cutoff = static_cast<std::uint64_t>(ld);
+            } catch (...) {}
+        } else if (key == "cache") {
+            cfg.cache = val;
+        } else if (key == "stats") {
+            if (val == "off" || val == "0") cfg.stats = StatsMode::Off;
+            else if (val == "on" || val == "1") cfg.stats = StatsMode::On;
+            else if (val == "perf") cfg.stats = StatsMode::Perf;
+        } else if (key == "affinity") {
+            if (val == "none") cfg.affinity = Affinity::None;
+            else if (val == "compact") cfg.affinity = Affinity::Compact;
+            else if (val == "scatter") cfg.affinity = Affinity::Scatter;
+        } else if (key == "analytics") {
+            if (val == "off" || val == "0") cfg.analytics = false;
+            else if (val == "on" || val == "1") cfg.analytics = true;
+        } else if (key == "pi_max") {
+            try {
+                long double ld = std::stold(val);
+                if (ld >= 0 && ld <= 1.8e19L) cfg.pi_max = static_cast<std::uint64_t>(ld);
+            } catch (...) {}
         }
     }
     return cfg;
@@ -122,9 +305,19 @@ inline Config load_config(const std::string& path = "config.txt") {
     if (c) cfg = *c; else print_line("[WARNING] config.txt not found — using defaults.");
     if (cfg.threads == 0) { cfg.threads = 1; print_line("[WARNING] threads < 1 — clamped to 1."); }
     if (cfg.limit < 2) { cfg.limit = 2; print_line("[WARNING] limit < 2 — clamped to 2."); }
+    if (cfg.start > cfg.limit) { cfg.start = 2; print_line("[WARNING] start > limit — reset to 2."); }
+    if (cfg.stats != StatsMode::Off) RunStats::get().enable(cfg.stats);
+    if (cfg.analytics) RunAnalytics::get().enable();
     return cfg;
 }
 
+inline std::uint64_t isqrt64(std::uint64_t n) {
+    std::uint64_t r = static_cast<std::uint64_t>(std::sqrt((long double)n));
+    while (r > 0 && static_cast<__uint128_t>(r) * r > n) --r;
+    while (static_cast<__uint128_t>(r + 1) * (r + 1) <= n) ++r;
+    return r;
+}
+
 inline bool is_prime_single(std::uint64_t n) {
     if (n < 2) return false;
     if (n == 2 || n == 3) return true;
@@ -145,10 +338,15 @@ inline void print_summary(const char* title,
     std::ostringstream oss;
     oss << "[SUMMARY] " << title
         << " | threads=" << cfg.threads
-        << " | limit=" << cfg.limit
-        << " | primes=" << primes_found
+        << " | limit=" << cfg.limit;
+    if (cfg.start != 2) oss << " | start=" << cfg.start;
+    oss << " | primes=" << primes_found
         << " | elapsed=" << ms << " ms";
     print_line(oss.str());
+    if (cfg.affinity != Affinity::None) print_line("[AFFINITY] " + PlacementLog::get().report(cfg.affinity));
+    if (RunStats::get().enabled()) print_line("[STATS] " + RunStats::get().json(title));
+    if (RunAnalytics::get().enabled() && cfg.mode == RunMode::Enumerate)
+        print_line("[ANALYTICS] " + RunAnalytics::get().report());
 }
 
 #endif 
\ No newline at end of file
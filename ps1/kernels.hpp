@@ -0,0 +1,273 @@
+#ifndef kernels_hpp
+#define kernels_hpp
+
+#include "cache.hpp"
+#include "miller_rabin.hpp"
+#include "pool.hpp"
+#include "primeset.hpp"
+#include "sieve.hpp"
+
+// The search strategies behind v1-v5 as plain functions, so the programs
+// and the benchmark driver run the same code. Kernels never print: each
+// found prime is handed to on_prime(n, worker), where worker identifies the
+// calling thread (worker index for the range-split and sieve kernels, pool
+// index for the cooperative one). Each returns the number of primes found.
+
+// v1/v2: threads test [start, limit] per cfg.schedule, one number at a time.
+template <class OnPrime>
+inline std::size_t run_range_split(const Config& cfg, OnPrime&& on_prime) {
+    if (cfg.test == PrimalityTest::Trial) prepare_trial_table(cfg.limit);
+    std::uint64_t start = cfg.start;
+    std::uint64_t end = cfg.limit;
+    std::uint64_t total = (end >= start) ? (end - start + 1) : 0;
+    RangeScheduler sched(cfg, start, total);
+    std::atomic<std::size_t> primes{0};
+
+    auto worker = [&](unsigned idx){
+        AffinityScope pin(cfg.affinity, idx);
+        StatsScope stats(idx);
+        std::size_t found = 0;
+        std::uint64_t tested = 0, checks = 0;
+        sched.run(idx, [&](WorkerSlice slice, std::size_t){
+            StatsTimer busy(&WorkerStats::busy_ns);
+            AnalyticsSlice gaps(slice.begin);
+            // the part of the slice below 2^32 runs the 32-bit instantiation
+            std::uint64_t narrow = slice.begin > 0xffffffffu ? 0
+                : std::min<std::uint64_t>(slice.count, 0x100000000ull - slice.begin);
+            for (std::uint64_t offset = 0; offset < narrow; ++offset) {
+                auto n = static_cast<std::uint32_t>(slice.begin + offset);
+                if (test_prime_as(cfg, n, checks)) { on_prime(std::uint64_t{n}, idx); gaps.add(n); ++found; }
+            }
+            for (std::uint64_t offset = narrow; offset < slice.count; ++offset) {
+                std::uint64_t n = slice.begin + offset;
+                if (test_prime_as(cfg, n, checks)) { on_prime(n, idx); gaps.add(n); ++found; }
+            }
+            tested += slice.count;
+        });
+        primes.fetch_add(found, std::memory_order_relaxed);
+        stats_count(tested, checks, found);
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < cfg.threads; ++i) workers.emplace_back(worker, i);
+    for (auto& th : workers) th.join();
+    return primes.load();
+}
+
+// v3/v4: numbers are visited in order and each large one is split by
+// divisor across the fork-join pool; the last tester to finish reports it.
+// Each tester takes a contiguous share of the prime table (trial.hpp) and
+// every k-th odd divisor past it.
+template <class OnPrime>
+inline std::size_t run_cooperative(const Config& cfg, OnPrime&& on_prime) {
+    if (cfg.test == PrimalityTest::Trial) prepare_trial_table(cfg.limit);
+    ForkJoinPool pool(cfg.threads);
+    std::atomic<std::size_t> primes_found{0};
+    constexpr std::size_t kTrialBlock = 256;  // table primes between early-exit checks
+
+    // pool index i is always the same thread, so each pins itself and
+    // attaches to its stats slot once
+    const bool stats = RunStats::get().enabled();
+    const bool pinned = cfg.affinity != Affinity::None;
+    if (stats || pinned) pool.run(pool.size(), [&](unsigned idx){
+        affinity_attach(cfg.affinity, idx);
+        stats_attach(idx);
+    });
+    const std::uint64_t t_begin = stats ? RunStats::get().now_ns() : 0;
+    std::uint64_t pool_ns = 0, inline_checks = 0, inline_tested = 0, inline_found = 0;
+    // numbers finish in order (pool.run joins), so the whole range is one slice
+    AnalyticsSlice gaps(cfg.start);
+    auto report = [&](std::uint64_t n, unsigned idx){ on_prime(n, idx); gaps.add(n); };
+
+    for (std::uint64_t n = cfg.start; n <= cfg.limit; ++n) {
+        ++inline_tested;
+        if (n == 2 || n == 3) { ++primes_found; ++inline_found; report(n, 0u); continue; }
+        if ((n % 2) == 0) continue;
+        if (n < 9) { ++primes_found; ++inline_found; report(n, 0u); continue; }
+        // Miller-Rabin has no divisor range to split: test on this thread
+        if (cfg.threads <= 1 || cfg.test == PrimalityTest::MillerRabin) {
+            if (test_prime(cfg, n, inline_checks)) { ++primes_found; ++inline_found; report(n, 0u); }
+            continue;
+        }
+        const TrialPlan t = plan_trial(n);
+        const std::uint64_t tail = t.s >= t.next_odd ? (t.s - t.next_odd) / 2 + 1 : 0;
+        const std::uint64_t cand = t.size() + tail;
+        unsigned int k = static_cast<unsigned int>(std::min<std::uint64_t>(cfg.threads, cand));
+        // too few divisors to amortize waking the pool: test on this thread
+        if (k <= 1 || cand < cfg.coop_cutoff) {
+            if (is_prime_trial(n, inline_checks)) { ++primes_found; ++inline_found; report(n, 0u); }
+            continue;
+        }
+        --inline_tested;
+
+        std::atomic<bool> composite{false};
+        std::atomic<unsigned> remaining{k};
+
+        auto tester = [&](unsigned idx){
+            StatsTimer busy(&WorkerStats::busy_ns);
+            std::uint64_t checks = 0;
+            bool reported = false;
+            auto share = compute_worker_slice(0, t.size(), k, idx);
+            for (std::uint64_t i = share.begin, e = share.begin + share.count;
+                 i < e && !composite.load(std::memory_order_relaxed); i += kTrialBlock) {
+                std::uint64_t be = std::min<std::uint64_t>(e, i + kTrialBlock);
+                std::uint64_t at = t.first_dividing(i, be);
+                checks += at - i;
+                if (at < be) {
+                    ++checks;
+                    composite.store(true, std::memory_order_relaxed);
+                    break;
+                }
+            }
+            for (std::uint64_t d = t.next_odd + 2*idx;
+                 d <= t.s && !composite.load(std::memory_order_relaxed);
+                 d += 2*k) {
+                ++checks;
+                if ((n % d) == 0) {
+                    composite.store(true, std::memory_order_relaxed);
+                    break;
+                }
+            }
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                if (!composite.load(std::memory_order_acquire)) {
+                    ++primes_found;
+                    reported = true;
+                    report(n, idx);
+                }
+            }
+            stats_count(idx == 0, checks, reported);
+        };
+        if (stats) {
+            std::uint64_t t0 = RunStats::get().now_ns();
+            pool.run(k, tester);
+            pool_ns += RunStats::get().now_ns() - t0;
+        } else {
+            pool.run(k, tester);
+        }
+    }
+
+    if (stats) {
+        // this thread was busy whenever it was not inside pool.run (its own
+        // tester share inside pool.run is already counted by the tester)
+        if (WorkerStats* s = current_stats()) s->busy_ns += RunStats::get().now_ns() - t_begin - pool_ns;
+        stats_count(inline_tested, inline_checks, inline_found);
+    }
+    if (stats || pinned) pool.run(pool.size(), [](unsigned){
+        stats_detach();
+        affinity_detach();
+    });
+    return primes_found.load();
+}
+
+// v5: threads sieve their slices one cache-sized segment at a time.
+template <class OnPrime>
+inline std::size_t run_sieve(const Config& cfg, OnPrime&& on_prime) {
+    std::uint64_t start = cfg.start;
+    std::uint64_t end = cfg.limit;
+    std::uint64_t total = (end >= start) ? (end - start + 1) : 0;
+    const auto base = sieve_base_primes(end);
+    // dynamic chunks are rounded up to whole segments so no segment is sieved twice
+    RangeScheduler sched(cfg, start, total, kSieveSegmentSpan);
+    std::atomic<std::size_t> primes{0};
+
+    auto worker = [&](unsigned idx){
+        AffinityScope pin(cfg.affinity, idx);
+        StatsScope stats(idx);
+        std::vector<std::uint8_t> seg;
+        std::size_t found = 0;
+        std::uint64_t sieved = 0;
+        sched.run(idx, [&](WorkerSlice slice, std::size_t){
+            StatsTimer busy(&WorkerStats::busy_ns);
+            AnalyticsSlice gaps(slice.begin);
+            std::uint64_t last = slice.begin + (slice.count - 1);
+            for_each_prime(slice.begin, last, base, seg,
+                           [&](std::uint64_t p){ on_prime(p, idx); gaps.add(p); ++found; });
+            sieved += slice.count;
+        });
+        primes.fetch_add(found, std::memory_order_relaxed);
+        stats_count(sieved, 0, found);
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < cfg.threads; ++i) workers.emplace_back(worker, i);
+    for (auto& th : workers) th.join();
+    return primes.load();
+}
+
+enum class Kernel { RangeSplit, Cooperative, Sieve };
+
+template <class OnPrime>
+inline std::size_t run_kernel(Kernel kernel, const Config& cfg, OnPrime&& on_prime) {
+    switch (kernel) {
+        case Kernel::RangeSplit: return run_range_split(cfg, on_prime);
+        case Kernel::Cooperative: return run_cooperative(cfg, on_prime);
+        case Kernel::Sieve: return run_sieve(cfg, on_prime);
+    }
+    return 0;
+}
+
+inline void report_cache(const Config& cfg, std::uint64_t tail_start) {
+    std::ostringstream oss;
+    oss << "[CACHE] " << cfg.cache << ": ";
+    if (tail_start == cfg.start) oss << "nothing reusable";
+    else oss << "reused [" << cfg.start << ", " << tail_start - 1 << "]";
+    if (tail_start <= cfg.limit) oss << ", computing [" << tail_start << ", " << cfg.limit << "]";
+    print_line(oss.str());
+}
+
+// Deferred-print form (v2, v4, v5): primes are marked in place in a PrimeSet.
+// With cfg.cache the cached prefix is loaded first and only the rest is
+// computed and appended to the cache.
+// With pinned static slices the set is zeroed from the workers' CPUs
+// first, so each slice's words live on its worker's node.
+inline PrimeSet make_result_set(Kernel kernel, const Config& cfg) {
+    if (cfg.affinity == Affinity::None || cfg.schedule != Schedule::Static ||
+        kernel == Kernel::Cooperative || cfg.threads <= 1)
+        return PrimeSet(cfg.start, cfg.limit);
+    return PrimeSet(cfg.start, cfg.limit, [&](std::uint64_t* words, std::size_t n){
+        first_touch_zero(words, n, cfg.threads, cfg.affinity);
+    });
+}
+
+inline PrimeSet collect_primes(Kernel kernel, const Config& cfg) {
+    PrimeSet primes = make_result_set(kernel, cfg);
+    Config tail = cfg;
+    std::optional<PrimeCache> cache;
+    if (!cfg.cache.empty()) {
+        cache.emplace(cfg.cache);
+        tail.start = cache->load_into(primes);
+        report_cache(cfg, tail.start);
+        if (RunAnalytics::get().enabled() && tail.start > cfg.start) {
+            AnalyticsSlice gaps(cfg.start);
+            primes.for_each([&](std::uint64_t p){ gaps.add(p); });
+        }
+    }
+    if (tail.start <= tail.limit)
+        run_kernel(kernel, tail, [&](std::uint64_t n, unsigned){ primes.insert(n); });
+    if (cache) cache->append(primes);
+    primes.build_index();
+    return primes;
+}
+
+// Immediate-print form (v1, v3) with cfg.cache: cached primes are passed to
+// on_cached(n) on this thread before the kernel starts, the rest to
+// on_prime as in run_kernel. Returns the total count.
+template <class OnCached, class OnPrime>
+inline std::size_t run_kernel_cached(Kernel kernel, const Config& cfg, OnCached&& on_cached, OnPrime&& on_prime) {
+    if (cfg.cache.empty()) return run_kernel(kernel, cfg, on_prime);
+    PrimeCache cache(cfg.cache);
+    std::size_t found = 0;
+    Config tail = cfg;
+    {
+        AnalyticsSlice gaps(cfg.start);
+        tail.start = cache.for_each(cfg.start, cfg.limit, [&](std::uint64_t n){ on_cached(n); gaps.add(n); ++found; });
+    }
+    report_cache(cfg, tail.start);
+    if (tail.start > tail.limit) return found;
+    PrimeSet computed(tail.start, tail.limit);
+    found += run_kernel(kernel, tail, [&](std::uint64_t n, unsigned idx){ computed.insert(n); on_prime(n, idx); });
+    cache.append(computed);
+    return found;
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef miller_rabin_hpp
+#define miller_rabin_hpp
+
+#include "helpers.hpp"
+#include "trial.hpp"
+
+// Montgomery arithmetic modulo an odd n of width U, R = 2^bits(U). Products
+// are formed in the next wider type: 64-bit for U = uint32_t, __uint128_t
+// for U = uint64_t, so moduli below 2^32 avoid 128-bit multiplies and
+// divisions altogether.
+template <class U>
+struct MontgomeryT {
+    using Wide = std::conditional_t<sizeof(U) == 4, std::uint64_t, __uint128_t>;
+    static constexpr unsigned kBits = 8 * sizeof(U);
+
+    U n;
+    U n_inv;  // n * n_inv == 1 (mod R)
+    U r2;     // R^2 mod n
+    U one;    // R mod n
+
+    explicit MontgomeryT(U modulus) : n(modulus) {
+        n_inv = n;  // correct to 3 bits for odd n; each step doubles that
+        for (int i = 0; i < 5; ++i) n_inv *= 2 - n * n_inv;
+        one = static_cast<U>(0 - n) % n;
+        r2 = static_cast<U>(static_cast<Wide>(one) * one % n);
+    }
+
+    // t * R^-1 mod n for t < n * R; the subtracting form never overflows,
+    // so the full range of U is supported.
+    U reduce(Wide t) const noexcept {
+        U m = static_cast<U>(t) * n_inv;
+        U mn_hi = static_cast<U>((static_cast<Wide>(m) * n) >> kBits);
+        U t_hi = static_cast<U>(t >> kBits);
+        return t_hi >= mn_hi ? t_hi - mn_hi : t_hi - mn_hi + n;
+    }
+
+    U mul(U a, U b) const noexcept {
+        return reduce(static_cast<Wide>(a) * b);
+    }
+    U to(U a) const noexcept { return mul(a % n, r2); }
+
+    U pow(U base_m, U e) const noexcept {
+        U r = one;
+        while (e) {
+            if (e & 1) r = mul(r, base_m);
+            base_m = mul(base_m, base_m);
+            e >>= 1;
+        }
+        return r;
+    }
+};
+
+using Montgomery = MontgomeryT<std::uint64_t>;
+
+// Strong probable-prime test of odd n > 2 to base a, with n - 1 = d * 2^s.
+template <class U>
+inline bool mr_strong_probable_prime(const MontgomeryT<U>& mg, U a, U d, unsigned s) {
+    a %= mg.n;
+    if (a == 0) return true;
+    U minus_one = mg.n - mg.one;  // (n - 1) * R mod n
+    U x = mg.pow(mg.to(a), d);
+    if (x == mg.one || x == minus_one) return true;
+    for (unsigned r = 1; r < s; ++r) {
+        x = mg.mul(x, x);
+        if (x == minus_one) return true;
+        if (x == mg.one) return false;
+    }
+    return false;
+}
+
+// Deterministic for every n of width U: {2, 7, 61} is exact below
+// 4,759,123,141 (Jaeschke), so all of 2^32, and the 7-base set of Sinclair
+// covers the rest of 2^64.
+template <class U>
+inline bool is_prime_mr_as(U n) {
+    static constexpr std::uint32_t small[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+    if (n < 2) return false;
+    for (std::uint32_t p : small) {
+        if (n == p) return true;
+        if (n % p == 0) return false;
+    }
+    if (n < 53u * 53u) return true;
+
+    U d = n - 1;
+    unsigned s = 0;
+    while ((d & 1) == 0) { d >>= 1; ++s; }
+    MontgomeryT<U> mg(n);
+
+    if (sizeof(U) == 4 || n < 4'759'123'141ull) {
+        for (U a : {2u, 7u, 61u})
+            if (!mr_strong_probable_prime<U>(mg, a, d, s)) return false;
+        return true;
+    }
+    for (std::uint64_t a : {2ull, 325ull, 9375ull, 28178ull, 450775ull, 9780504ull, 1795265022ull})
+        if (!mr_strong_probable_prime<U>(mg, static_cast<U>(a), d, s)) return false;
+    return true;
+}
+
+inline bool is_prime_mr(std::uint64_t n) {
+    return n <= 0xffffffffu ? is_prime_mr_as<std::uint32_t>(static_cast<std::uint32_t>(n))
+                            : is_prime_mr_as<std::uint64_t>(n);
+}
+
+// Primality test selected by cfg.test; every variant's per-number check goes through here.
+inline bool test_prime(const Config& cfg, std::uint64_t n) {
+    return cfg.test == PrimalityTest::MillerRabin ? is_prime_mr(n) : is_prime_trial(n);
+}
+
+// Width-U instantiation, for kernels that have already split their range
+// at 2^32; checks gets the trial divisors tried (none for Miller-Rabin).
+template <class U>
+inline bool test_prime_as(const Config& cfg, U n, std::uint64_t& checks) {
+    return cfg.test == PrimalityTest::MillerRabin ? is_prime_mr_as<U>(n) : is_prime_trial_as<U>(n, checks);
+}
+
+inline bool test_prime(const Config& cfg, std::uint64_t n, std::uint64_t& checks) {
+    return n <= 0xffffffffu ? test_prime_as<std::uint32_t>(cfg, static_cast<std::uint32_t>(n), checks)
+                            : test_prime_as<std::uint64_t>(cfg, n, checks);
+}
+
+#endif
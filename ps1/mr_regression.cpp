@@ -0,0 +1,43 @@
+#include "miller_rabin.hpp"
+#include "sieve.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+void check_against_sieve(std::uint64_t lo, std::uint64_t hi) {
+    std::vector<std::uint8_t> seg;
+    std::uint64_t expect = lo;
+    for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t p){
+        for (; expect < p; ++expect) assert(!is_prime_mr(expect));
+        assert(is_prime_mr(p));
+        expect = p + 1;
+    });
+    for (; expect <= hi; ++expect) assert(!is_prime_mr(expect));
+}
+
+}
+int main() {
+    check_against_sieve(0, 2'000'000);
+    // top of the 32-bit sieve and test instantiations, where offsets wrap
+    check_against_sieve(4'294'967'295ull - 300'000, 4'294'967'295ull);
+    for (std::uint64_t n = 4'294'967'295ull - 100'000; n <= 4'294'967'295ull; ++n)
+        assert(is_prime_mr_as<std::uint32_t>(static_cast<std::uint32_t>(n)) == is_prime_mr_as<std::uint64_t>(n));
+    check_against_sieve(4'759'123'141ull - 100'000, 4'759'123'141ull + 100'000);
+    check_against_sieve(1'000'000'000'000'000'000ull, 1'000'000'000'000'000'000ull + 200'000);
+
+    // strong pseudoprimes to the smaller base sets
+    assert(!is_prime_mr(3'215'031'751ull));
+    assert(!is_prime_mr(4'759'123'141ull));
+    assert(!is_prime_mr(3'825'123'056'546'413'051ull));
+
+    // largest primes below 2^63 and 2^64
+    assert(is_prime_mr(9'223'372'036'854'775'783ull));
+    assert(!is_prime_mr(9'223'372'036'854'775'807ull));
+    assert(is_prime_mr(18'446'744'073'709'551'557ull));
+    assert(!is_prime_mr(std::numeric_limits<std::uint64_t>::max()));
+    assert(!is_prime_mr(4'294'967'291ull * 4'294'967'279ull));
+    return 0;
+}
@@ -0,0 +1,185 @@
+#ifndef output_hpp
+#define output_hpp
+
+#include "helpers.hpp"
+
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Single-writer output path for the immediate-print variants. Producers fill
+// private LineWriter buffers and hand over whole blocks; one writer thread
+// drains them to the fd with writev(2). In PrintMode::Immediate nothing is
+// queued: each line goes straight to std::cout under cout_mutex() as before,
+// so the log can still be tailed line by line.
+class OutputPipeline {
+public:
+    static constexpr std::size_t kBlockBytes = 1u << 16;
+    static constexpr std::size_t kMaxQueued = 256;
+
+    explicit OutputPipeline(PrintMode mode, int fd = STDOUT_FILENO) : mode_(mode), fd_(fd) {
+        if (mode_ != PrintMode::Buffered) return;
+        {
+            // anything already in cout's buffer must reach the fd before our blocks
+            std::lock_guard<std::mutex> lock(cout_mutex());
+            std::cout.flush();
+        }
+        writer_ = std::thread([this]{ writer_loop(); });
+    }
+
+    ~OutputPipeline() { finish(); }
+
+    OutputPipeline(const OutputPipeline&) = delete;
+    OutputPipeline& operator=(const OutputPipeline&) = delete;
+
+    PrintMode mode() const noexcept { return mode_; }
+
+    // Queues a filled block; blocks the producer only if the writer is kMaxQueued behind.
+    void submit(std::string&& block) {
+        if (block.empty()) return;
+        auto lk = timed_lock(m_);
+        if (queue_.size() >= kMaxQueued) {
+            StatsTimer wait(&WorkerStats::lock_wait_ns);
+            space_cv_.wait(lk, [&]{ return queue_.size() < kMaxQueued; });
+        }
+        queue_.push_back(std::move(block));
+        lk.unlock();
+        cv_.notify_one();
+    }
+
+    // Returns an empty buffer, recycled from the writer when possible.
+    std::string acquire() {
+        std::string s;
+        {
+            auto lk = timed_lock(m_);
+            if (!spare_.empty()) { s = std::move(spare_.back()); spare_.pop_back(); }
+        }
+        s.clear();
+        s.reserve(kBlockBytes + 128);
+        return s;
+    }
+
+    // Drains everything submitted so far and stops the writer.
+    void finish() {
+        if (!writer_.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            done_ = true;
+        }
+        cv_.notify_one();
+        writer_.join();
+    }
+
+private:
+    void writer_loop() {
+        std::vector<std::string> batch;
+        std::vector<iovec> iov;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                cv_.wait(lk, [&]{ return !queue_.empty() || done_; });
+                if (queue_.empty()) return;
+                while (!queue_.empty()) { batch.push_back(std::move(queue_.front())); queue_.pop_front(); }
+            }
+            space_cv_.notify_all();
+
+            iov.clear();
+            for (auto& b : batch) iov.push_back(iovec{b.data(), b.size()});
+            write_all(iov);
+
+            std::lock_guard<std::mutex> lk(m_);
+            for (auto& b : batch) if (spare_.size() < kMaxQueued) spare_.push_back(std::move(b));
+            batch.clear();
+        }
+    }
+
+    void write_all(std::vector<iovec>& iov) {
+        std::size_t i = 0;
+        while (i < iov.size() && !failed_) {
+            int cnt = static_cast<int>(std::min<std::size_t>(iov.size() - i, IOV_MAX));
+            ssize_t w = ::writev(fd_, iov.data() + i, cnt);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                failed_ = true;  // e.g. EPIPE: drop the rest rather than spin
+                return;
+            }
+            std::size_t left = static_cast<std::size_t>(w);
+            while (i < iov.size() && left >= iov[i].iov_len) { left -= iov[i].iov_len; ++i; }
+            if (left > 0) {
+                iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + left;
+                iov[i].iov_len -= left;
+            }
+        }
+    }
+
+    PrintMode mode_;
+    int fd_;
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::condition_variable space_cv_;
+    std::deque<std::string> queue_;
+    std::vector<std::string> spare_;
+    bool done_ = false;
+    bool failed_ = false;
+    std::thread writer_;
+};
+
+// Per-thread formatter for "[timestamp] [thread id] prime=n" lines. Owned by
+// exactly one thread at a time; the thread id is captured on first use.
+class LineWriter {
+public:
+    explicit LineWriter(OutputPipeline& out) : out_(out) {
+        if (out_.mode() == PrintMode::Buffered) buf_ = out_.acquire();
+    }
+    ~LineWriter() { flush(); }
+
+    LineWriter(const LineWriter&) = delete;
+    LineWriter& operator=(const LineWriter&) = delete;
+
+    void prime(std::uint64_t n) {
+        if (tid_.empty()) {
+            std::ostringstream oss;
+            oss << std::this_thread::get_id();
+            tid_ = oss.str();
+        }
+        std::string& line = out_.mode() == PrintMode::Buffered ? buf_ : scratch_;
+        line += '[';
+        line += clock_.now();
+        line += "] [thread ";
+        line += tid_;
+        line += "] prime=";
+        char num[24];
+        auto [end, ec] = std::to_chars(num, num + sizeof(num), n);
+        line.append(num, end);
+        line += '\n';
+
+        if (out_.mode() == PrintMode::Immediate) {
+            auto lock = timed_lock(cout_mutex());
+            std::cout.write(scratch_.data(), static_cast<std::streamsize>(scratch_.size()));
+            scratch_.clear();
+        } else if (buf_.size() >= OutputPipeline::kBlockBytes) {
+            out_.submit(std::move(buf_));
+            buf_ = out_.acquire();
+        }
+    }
+
+    void flush() {
+        if (out_.mode() == PrintMode::Buffered && !buf_.empty()) {
+            out_.submit(std::move(buf_));
+            buf_.clear();
+        }
+    }
+
+private:
+    OutputPipeline& out_;
+    std::string buf_;
+    std::string scratch_;
+    std::string tid_;
+    TimestampCache clock_;
+};
+
+#endif
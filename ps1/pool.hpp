@@ -0,0 +1,85 @@
+#ifndef pool_hpp
+#define pool_hpp
+
+#include "helpers.hpp"
+
+#include <type_traits>
+
+// Reusable fork-join pool. size() - 1 workers are created once and stay
+// parked on a generation counter between jobs; run() publishes a job, the
+// caller takes index 0 itself, and returns once every index has finished.
+// Workers spin (yielding) briefly before falling back to a futex-style
+// atomic wait, so back-to-back jobs (one per candidate in v3/v4) rarely park.
+class ForkJoinPool {
+public:
+    explicit ForkJoinPool(unsigned int threads) : size_(std::max(1u, threads)) {
+        workers_.reserve(size_ - 1);
+        for (unsigned i = 1; i < size_; ++i) workers_.emplace_back([this, i]{ worker_loop(i); });
+    }
+
+    ~ForkJoinPool() {
+        stop_ = true;
+        generation_.fetch_add(1, std::memory_order_release);
+        generation_.notify_all();
+        for (auto& th : workers_) th.join();
+    }
+
+    ForkJoinPool(const ForkJoinPool&) = delete;
+    ForkJoinPool& operator=(const ForkJoinPool&) = delete;
+
+    unsigned int size() const noexcept { return size_; }
+
+    // Calls fn(idx) for every idx in [0, k); k is clamped to size().
+    template <class Fn>
+    void run(unsigned int k, Fn&& fn) {
+        k = std::min(k, size_);
+        if (k == 0) return;
+        if (size_ == 1) { fn(0u); return; }
+
+        job_ctx_ = static_cast<void*>(&fn);
+        job_fn_ = [](void* ctx, unsigned idx){ (*static_cast<std::remove_reference_t<Fn>*>(ctx))(idx); };
+        job_k_ = k;
+        pending_.store(size_ - 1, std::memory_order_relaxed);
+        generation_.fetch_add(1, std::memory_order_release);
+        generation_.notify_all();
+
+        fn(0u);
+
+        for (unsigned spin = 0; pending_.load(std::memory_order_acquire) != 0; ++spin) {
+            if (spin < kSpin) { std::this_thread::yield(); continue; }
+            unsigned left = pending_.load(std::memory_order_acquire);
+            if (left != 0) pending_.wait(left, std::memory_order_acquire);
+        }
+    }
+
+private:
+    static constexpr unsigned kSpin = 1u << 10;
+
+    void worker_loop(unsigned idx) {
+        std::uint64_t seen = 0;
+        for (;;) {
+            std::uint64_t gen;
+            for (unsigned spin = 0; (gen = generation_.load(std::memory_order_acquire)) == seen; ++spin) {
+                if (spin < kSpin) std::this_thread::yield();
+                else generation_.wait(seen, std::memory_order_acquire);
+            }
+            seen = gen;
+            if (stop_) return;
+            // every worker acknowledges every job, so none can still be reading
+            // job_* when the next run() overwrites them
+            if (idx < job_k_) job_fn_(job_ctx_, idx);
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) pending_.notify_one();
+        }
+    }
+
+    unsigned int size_;
+    std::vector<std::thread> workers_;
+    std::atomic<std::uint64_t> generation_{0};
+    std::atomic<unsigned> pending_{0};
+    void* job_ctx_ = nullptr;
+    void (*job_fn_)(void*, unsigned) = nullptr;
+    unsigned int job_k_ = 0;
+    bool stop_ = false;
+};
+
+#endif
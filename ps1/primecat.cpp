@@ -0,0 +1,72 @@
+#include "primefile.hpp"
+
+#include <charconv>
+#include <limits>
+
+// Decoder for the .pbin files written with format=binary.
+//   ./primecat FILE                  print every prime, one per line
+//   ./primecat FILE --from X --to Y  print primes in [X, Y] (seeks through the index)
+//   ./primecat FILE --count ...      print how many primes fall in the range instead
+//   ./primecat FILE --info           print the header
+namespace {
+
+bool parse_u64(const char* s, std::uint64_t& out) {
+    const char* end = s + std::strlen(s);
+    auto [ptr, ec] = std::from_chars(s, end, out);
+    return ec == std::errc{} && ptr == end;
+}
+
+int usage() {
+    std::cerr << "usage: primecat FILE [--info] [--count] [--from X] [--to Y]\n";
+    return 2;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    std::string path = argv[1];
+    bool info = false, count_only = false;
+    std::uint64_t from = 0, to = std::numeric_limits<std::uint64_t>::max();
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--info") info = true;
+        else if (a == "--count") count_only = true;
+        else if (a == "--from" && i + 1 < argc) { if (!parse_u64(argv[++i], from)) return usage(); }
+        else if (a == "--to" && i + 1 < argc) { if (!parse_u64(argv[++i], to)) return usage(); }
+        else return usage();
+    }
+
+    PrimeFileReader r(path);
+    if (!r.ok()) {
+        std::cerr << "[ERROR] " << path << ": " << r.error() << '\n';
+        return 1;
+    }
+
+    if (info) {
+        const auto& h = r.header();
+        std::cout << "count=" << h.count << "\nfirst=" << h.first << "\nlast=" << h.last
+                  << "\nblock_primes=" << h.block_primes << "\nblocks=" << h.block_count << '\n';
+        return 0;
+    }
+
+    std::uint64_t n = 0;
+    std::string buf;
+    buf.reserve(1u << 16);
+    for (auto it = r.lower_bound(from); it != r.end() && *it <= to; ++it) {
+        ++n;
+        if (count_only) continue;
+        char num[24];
+        auto [end, ec] = std::to_chars(num, num + sizeof(num), *it);
+        buf.append(num, end);
+        buf += '\n';
+        if (buf.size() >= (1u << 16) - 32) { std::fwrite(buf.data(), 1, buf.size(), stdout); buf.clear(); }
+    }
+    if (count_only) std::cout << n << '\n';
+    else std::fwrite(buf.data(), 1, buf.size(), stdout);
+    if (!r.intact()) {
+        std::cerr << "[ERROR] " << path << ": corrupt block\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,315 @@
+#ifndef primefile_hpp
+#define primefile_hpp
+
+#include "helpers.hpp"
+
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Compact prime file (.pbin), little-endian:
+//   header   PrimeFileHeader (64 bytes)
+//   blocks   for each block, the gaps p[i] - p[i-1] of its primes after the
+//            first one, as LEB128 varints (one byte for gaps < 128)
+//   pad      zero bytes up to a multiple of 8
+//   index    block_count x PrimeFileIndexEntry {first prime, data offset}
+// A block holds block_primes primes (the last may hold fewer). The first
+// prime of each block lives only in the index, so any block can be decoded
+// independently and seeking by value is a binary search over the index.
+static_assert(std::endian::native == std::endian::little, "primefile assumes a little-endian host");
+
+constexpr char kPrimeFileMagic[8] = {'P', 'R', 'I', 'M', 'E', 'B', 'I', 'N'};
+constexpr std::uint32_t kPrimeFileVersion = 1;
+constexpr std::uint32_t kPrimeFileBlockPrimes = 1u << 16;
+
+struct PrimeFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t block_primes;
+    std::uint64_t count;
+    std::uint64_t first;
+    std::uint64_t last;
+    std::uint64_t block_count;
+    std::uint64_t index_offset;
+    std::uint64_t reserved;
+};
+static_assert(sizeof(PrimeFileHeader) == 64);
+
+struct PrimeFileIndexEntry {
+    std::uint64_t first;
+    std::uint64_t offset;
+};
+
+inline std::size_t varint_put(std::uint8_t* out, std::uint64_t v) {
+    std::size_t n = 0;
+    while (v >= 0x80) { out[n++] = static_cast<std::uint8_t>(v | 0x80); v >>= 7; }
+    out[n++] = static_cast<std::uint8_t>(v);
+    return n;
+}
+
+// Decodes one varint from [in, end); nullptr if it runs past end or past 64 bits.
+inline const std::uint8_t* varint_get(const std::uint8_t* in, const std::uint8_t* end, std::uint64_t& v) {
+    v = 0;
+    for (unsigned shift = 0; in < end && shift < 64; shift += 7) {
+        std::uint8_t b = *in++;
+        v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) return in;
+    }
+    return nullptr;
+}
+
+// Streams ascending primes into a .pbin file; the header is finalized by close().
+class PrimeFileWriter {
+public:
+    explicit PrimeFileWriter(const std::string& path, std::uint32_t block_primes = kPrimeFileBlockPrimes)
+        : block_primes_(std::max(1u, block_primes)) {
+        f_ = std::fopen(path.c_str(), "wb");
+        if (!f_) return;
+        std::setvbuf(f_, nullptr, _IOFBF, 1u << 20);
+        PrimeFileHeader h{};
+        ok_ = std::fwrite(&h, sizeof(h), 1, f_) == 1;
+        offset_ = sizeof(h);
+    }
+
+    ~PrimeFileWriter() { close(); }
+
+    PrimeFileWriter(const PrimeFileWriter&) = delete;
+    PrimeFileWriter& operator=(const PrimeFileWriter&) = delete;
+
+    bool ok() const noexcept { return f_ != nullptr && ok_; }
+    std::uint64_t count() const noexcept { return count_; }
+    std::uint64_t bytes() const noexcept { return offset_; }
+
+    void push(std::uint64_t p) {
+        if (!ok()) return;
+        if (in_block_ == 0) {
+            if (count_ == 0) first_ = p;
+            index_.push_back(PrimeFileIndexEntry{p, offset_});
+        } else {
+            std::uint8_t tmp[10];
+            std::size_t n = varint_put(tmp, p - last_);
+            block_.insert(block_.end(), tmp, tmp + n);
+        }
+        last_ = p;
+        ++count_;
+        if (++in_block_ == block_primes_) flush_block();
+    }
+
+    bool close() {
+        if (!f_) return ok_;
+        flush_block();
+        // pad so the index is 8-aligned in the mapping; iteration stops at
+        // count, so the pad bytes are never decoded
+        constexpr std::size_t kAlign = alignof(PrimeFileIndexEntry);
+        static constexpr std::uint8_t kZero[kAlign] = {};
+        const std::size_t pad = (kAlign - offset_ % kAlign) % kAlign;
+        if (ok_ && pad) ok_ = std::fwrite(kZero, 1, pad, f_) == pad;
+        offset_ += pad;
+        PrimeFileHeader h{};
+        std::memcpy(h.magic, kPrimeFileMagic, sizeof(h.magic));
+        h.version = kPrimeFileVersion;
+        h.block_primes = block_primes_;
+        h.count = count_;
+        h.first = first_;
+        h.last = last_;
+        h.block_count = index_.size();
+        h.index_offset = offset_;
+        if (ok_ && !index_.empty())
+            ok_ = std::fwrite(index_.data(), sizeof(PrimeFileIndexEntry), index_.size(), f_) == index_.size();
+        offset_ += index_.size() * sizeof(PrimeFileIndexEntry);
+        if (ok_) ok_ = std::fseek(f_, 0, SEEK_SET) == 0 && std::fwrite(&h, sizeof(h), 1, f_) == 1;
+        if (std::fclose(f_) != 0) ok_ = false;
+        f_ = nullptr;
+        return ok_;
+    }
+
+private:
+    void flush_block() {
+        if (ok_ && !block_.empty())
+            ok_ = std::fwrite(block_.data(), 1, block_.size(), f_) == block_.size();
+        offset_ += block_.size();
+        block_.clear();
+        in_block_ = 0;
+    }
+
+    std::FILE* f_ = nullptr;
+    bool ok_ = false;
+    std::uint32_t block_primes_;
+    std::uint32_t in_block_ = 0;
+    std::uint64_t count_ = 0;
+    std::uint64_t first_ = 0;
+    std::uint64_t last_ = 0;
+    std::uint64_t offset_ = 0;
+    std::vector<std::uint8_t> block_;
+    std::vector<PrimeFileIndexEntry> index_;
+};
+
+// Read-only view of a .pbin file through mmap. Iteration decodes one varint
+// per prime; lower_bound() jumps to the right block through the index.
+// The constructor checks that the index offsets are ascending and lie
+// between the header and the index; a block whose varints then run past the
+// next block's offset ends the iteration early and clears intact().
+class PrimeFileReader {
+public:
+    class iterator {
+    public:
+        using value_type = std::uint64_t;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        std::uint64_t operator*() const noexcept { return value_; }
+        iterator& operator++() {
+            if (++pos_ == global_) return *this;
+            if (pos_ % r_->header_->block_primes == 0) {
+                load_block(pos_ / r_->header_->block_primes);
+            } else {
+                std::uint64_t gap;
+                p_ = varint_get(p_, end_, gap);
+                if (!p_) {
+                    r_->intact_ = false;
+                    pos_ = global_;
+                    return *this;
+                }
+                value_ += gap;
+            }
+            return *this;
+        }
+        iterator operator++(int) { auto t = *this; ++*this; return t; }
+        bool operator==(const iterator& o) const noexcept { return pos_ == o.pos_; }
+
+    private:
+        friend class PrimeFileReader;
+        iterator(const PrimeFileReader* r, std::uint64_t pos) : r_(r), pos_(pos), global_(r->size()) {
+            if (pos_ < global_) load_block(pos_ / r_->header_->block_primes);
+        }
+        void load_block(std::uint64_t b) {
+            const auto& e = r_->index_[b];
+            value_ = e.first;
+            p_ = r_->base_ + e.offset;
+            end_ = r_->base_ + (b + 1 < r_->header_->block_count ? r_->index_[b + 1].offset : r_->header_->index_offset);
+        }
+
+        const PrimeFileReader* r_ = nullptr;
+        std::uint64_t pos_ = 0;
+        std::uint64_t global_ = 0;
+        std::uint64_t value_ = 0;
+        const std::uint8_t* p_ = nullptr;
+        const std::uint8_t* end_ = nullptr;
+    };
+
+    explicit PrimeFileReader(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) { error_ = "cannot open " + path; return; }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(PrimeFileHeader))) {
+            ::close(fd);
+            error_ = "file too small";
+            return;
+        }
+        len_ = static_cast<std::size_t>(st.st_size);
+        void* m = ::mmap(nullptr, len_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (m == MAP_FAILED) { error_ = "mmap failed"; len_ = 0; return; }
+        base_ = static_cast<const std::uint8_t*>(m);
+        header_ = reinterpret_cast<const PrimeFileHeader*>(base_);
+        if (std::memcmp(header_->magic, kPrimeFileMagic, sizeof(kPrimeFileMagic)) != 0) { error_ = "bad magic"; return; }
+        if (header_->version != kPrimeFileVersion) { error_ = "unsupported version"; return; }
+        if (header_->block_primes == 0 ||
+            header_->index_offset > len_ ||
+            header_->index_offset % alignof(PrimeFileIndexEntry) != 0 ||
+            header_->block_count > (len_ - header_->index_offset) / sizeof(PrimeFileIndexEntry) ||
+            header_->block_count != (header_->count + header_->block_primes - 1) / header_->block_primes) {
+            error_ = "corrupt header";
+            return;
+        }
+        index_ = reinterpret_cast<const PrimeFileIndexEntry*>(base_ + header_->index_offset);
+        std::uint64_t offset = sizeof(PrimeFileHeader);
+        for (std::uint64_t b = 0; b < header_->block_count; ++b) {
+            const PrimeFileIndexEntry& e = index_[b];
+            if (e.offset < offset || e.offset > header_->index_offset ||
+                (b == 0 ? e.first != header_->first : e.first <= index_[b - 1].first)) {
+                error_ = "corrupt index";
+                return;
+            }
+            offset = e.offset;
+        }
+    }
+
+    ~PrimeFileReader() {
+        if (base_) ::munmap(const_cast<std::uint8_t*>(base_), len_);
+    }
+
+    PrimeFileReader(const PrimeFileReader&) = delete;
+    PrimeFileReader& operator=(const PrimeFileReader&) = delete;
+
+    bool ok() const noexcept { return error_.empty(); }
+    const std::string& error() const noexcept { return error_; }
+    const PrimeFileHeader& header() const noexcept { return *header_; }
+    std::uint64_t size() const noexcept { return ok() ? header_->count : 0; }
+    // false once an iteration hit a block that decodes past its end
+    bool intact() const noexcept { return intact_; }
+
+    iterator begin() const { return ok() ? iterator(this, 0) : iterator(); }
+    iterator end() const { return ok() ? iterator(this, size()) : iterator(); }
+
+    // First prime >= x, or end().
+    iterator lower_bound(std::uint64_t x) const {
+        if (!ok() || size() == 0 || x > header_->last) return end();
+        const PrimeFileIndexEntry* e = std::upper_bound(
+            index_, index_ + header_->block_count, x,
+            [](std::uint64_t v, const PrimeFileIndexEntry& ie){ return v < ie.first; });
+        std::uint64_t block = (e == index_) ? 0 : static_cast<std::uint64_t>(e - index_ - 1);
+        iterator it(this, block * header_->block_primes);
+        while (it != end() && *it < x) ++it;
+        return it;
+    }
+
+    bool contains(std::uint64_t x) const {
+        auto it = lower_bound(x);
+        return it != end() && *it == x;
+    }
+
+private:
+    const std::uint8_t* base_ = nullptr;
+    std::size_t len_ = 0;
+    const PrimeFileHeader* header_ = nullptr;
+    const PrimeFileIndexEntry* index_ = nullptr;
+    std::string error_;
+    mutable bool intact_ = true;
+};
+
+// Output destination for the deferred-print variants: decimal lines on
+// std::cout (the default) or a .pbin file, selected by cfg.format.
+class PrimeSink {
+public:
+    explicit PrimeSink(const Config& cfg) : path_(cfg.outfile) {
+        if (cfg.format == OutputFormat::Binary) file_ = std::make_unique<PrimeFileWriter>(path_);
+    }
+
+    void push(std::uint64_t p) {
+        if (file_) file_->push(p);
+        else std::cout << p << '\n';
+    }
+
+    // Finalizes a binary file; reports failures and the file size.
+    bool close() {
+        if (!file_) return true;
+        bool ok = file_->close();
+        std::ostringstream oss;
+        if (ok) oss << "[OUTPUT] " << file_->count() << " primes -> " << path_ << " (" << file_->bytes() << " bytes)";
+        else oss << "[ERROR] could not write " << path_;
+        print_line(oss.str());
+        return ok;
+    }
+
+private:
+    std::string path_;
+    std::unique_ptr<PrimeFileWriter> file_;
+};
+
+#endif
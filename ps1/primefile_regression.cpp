@@ -0,0 +1,127 @@
+#include "primefile.hpp"
+#include "sieve.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+
+const char* const kPath = "primefile_regression.pbin";
+constexpr std::uint32_t kBlock = 100;
+
+std::vector<std::uint64_t> read_range(const PrimeFileReader& r, std::uint64_t from, std::uint64_t to) {
+    std::vector<std::uint64_t> out;
+    for (auto it = r.lower_bound(from); it != r.end() && *it <= to; ++it) out.push_back(*it);
+    return out;
+}
+
+std::vector<std::uint64_t> ref_range(const std::vector<std::uint64_t>& ref, std::uint64_t from, std::uint64_t to) {
+    std::vector<std::uint64_t> out;
+    for (std::uint64_t p : ref)
+        if (p >= from && p <= to) out.push_back(p);
+    return out;
+}
+
+// Overwrites `size` bytes at `offset` of the test file.
+void patch(std::uint64_t offset, const void* data, std::size_t size) {
+    std::FILE* f = std::fopen(kPath, "r+b");
+    assert(f);
+    const bool ok = std::fseek(f, static_cast<long>(offset), SEEK_SET) == 0 && std::fwrite(data, 1, size, f) == size;
+    std::fclose(f);
+    assert(ok);
+}
+
+void write_file(const std::vector<std::uint64_t>& ref) {
+    PrimeFileWriter w(kPath, kBlock);
+    assert(w.ok());
+    for (std::uint64_t p : ref) w.push(p);
+    assert(w.close());
+}
+
+}
+
+// Writer -> reader round trip against the sieve, seeks at and across block
+// boundaries, and rejection of files whose index or blocks are corrupt.
+int main() {
+    std::vector<std::uint64_t> ref;
+    std::vector<std::uint8_t> seg;
+    const std::uint64_t lo = 1'000'000, hi = 1'100'000;
+    for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t p){ ref.push_back(p); });
+    assert(ref.size() > 10 * kBlock);
+    write_file(ref);
+
+    {
+        PrimeFileReader r(kPath);
+        assert(r.ok());
+        assert(r.size() == ref.size());
+        assert(r.header().first == ref.front() && r.header().last == ref.back());
+        assert(r.header().block_count == (ref.size() + kBlock - 1) / kBlock);
+        assert(r.header().index_offset % alignof(PrimeFileIndexEntry) == 0);
+        assert(std::equal(r.begin(), r.end(), ref.begin(), ref.end()));
+
+        // block firsts, their neighbours, and windows spanning several blocks
+        for (std::size_t b = 0; b < ref.size(); b += kBlock) {
+            const std::uint64_t first = ref[b];
+            for (std::uint64_t from : {first - 1, first, first + 1}) {
+                assert(read_range(r, from, from + 5000) == ref_range(ref, from, from + 5000));
+                assert(read_range(r, from - 3000, from) == ref_range(ref, from - 3000, from));
+            }
+            assert(r.contains(first));
+            if (b > 0) assert(*r.lower_bound(ref[b - 1] + 1) == first);
+        }
+        assert(read_range(r, 0, hi) == ref);
+        assert(read_range(r, ref.back(), ref.back()) == std::vector<std::uint64_t>{ref.back()});
+        assert(r.lower_bound(ref.back() + 1) == r.end());
+        assert(r.intact());
+    }
+
+    PrimeFileHeader h{};
+    {
+        PrimeFileReader r(kPath);
+        h = r.header();
+    }
+    const std::uint64_t entry = sizeof(PrimeFileIndexEntry);
+    const std::uint64_t offset_field = offsetof(PrimeFileIndexEntry, offset);
+
+    // an offset past the index
+    const std::uint64_t huge = ~std::uint64_t{0} - 7;
+    patch(h.index_offset + 3 * entry + offset_field, &huge, sizeof(huge));
+    {
+        PrimeFileReader r(kPath);
+        assert(!r.ok() && r.error() == "corrupt index");
+        assert(r.begin() == r.end());
+    }
+
+    // offsets out of order
+    write_file(ref);
+    const std::uint64_t back = sizeof(PrimeFileHeader);
+    patch(h.index_offset + 5 * entry + offset_field, &back, sizeof(back));
+    assert(!PrimeFileReader(kPath).ok());
+
+    // a block of unterminated varints stops at the next block's offset
+    write_file(ref);
+    {
+        PrimeFileIndexEntry e[2];
+        std::FILE* f = std::fopen(kPath, "rb");
+        assert(f);
+        const bool read = std::fseek(f, static_cast<long>(h.index_offset + 2 * entry), SEEK_SET) == 0 &&
+                          std::fread(e, sizeof(e[0]), 2, f) == 2;
+        std::fclose(f);
+        assert(read);
+        std::vector<std::uint8_t> junk(e[1].offset - e[0].offset, 0x80);
+        patch(e[0].offset, junk.data(), junk.size());
+
+        PrimeFileReader r(kPath);
+        assert(r.ok());
+        std::vector<std::uint64_t> got = read_range(r, 0, hi);
+        assert(!r.intact());
+        assert(got.size() == 2 * kBlock + 1);
+        assert(std::equal(got.begin(), got.end(), ref.begin()));
+    }
+
+    std::remove(kPath);
+    return 0;
+}
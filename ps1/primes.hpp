@@ -0,0 +1,234 @@
+#ifndef primes_hpp
+#define primes_hpp
+
+#include "sieve.hpp"
+
+#include <condition_variable>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <thread>
+
+// Lazy views over the primes in [lo, hi] (inclusive, like every range in
+// ps1), for library use:
+//
+//   for (std::uint64_t p : primes(1'000'000, 2'000'000)) ...
+//   for (std::uint64_t p : parallel_primes(lo, hi, 4)) ...
+//
+// Both sieve one segment (kSieveSegmentSpan numbers) at a time, so memory is
+// the base primes up to sqrt(hi) plus a few segment buffers, however wide
+// the range. primes() sieves on the consuming thread when the iterator
+// reaches the end of a segment. parallel_primes() has worker threads sieve
+// up to `depth` segments ahead into a ring of buffers while the consumer
+// walks the current one. It is single-pass: take begin() once.
+
+// Walks the flags of one sieved segment.
+struct PrimeSegmentCursor {
+    std::vector<std::uint8_t> seg;
+    std::uint64_t first = 0;
+    std::size_t i = 0;
+
+    // Next prime of the segment into p; false once the segment is exhausted.
+    bool next(std::uint64_t& p) {
+        while (i < seg.size()) {
+            if (seg[i++]) { p = first + 2 * (i - 1); return true; }
+        }
+        return false;
+    }
+};
+
+// Segment j of [lo, hi] is [lo + j * span, min(hi, lo + (j + 1) * span - 1)].
+struct PrimeSegmentPlan {
+    std::uint64_t lo = 1, hi = 0;
+    std::uint64_t segments = 0;
+
+    PrimeSegmentPlan() = default;
+    PrimeSegmentPlan(std::uint64_t l, std::uint64_t h) : lo(l), hi(h) {
+        segments = (lo <= hi) ? (hi - lo) / kSieveSegmentSpan + 1 : 0;
+    }
+    std::uint64_t seg_lo(std::uint64_t j) const { return lo + j * kSieveSegmentSpan; }
+    std::uint64_t seg_hi(std::uint64_t j) const {
+        return (hi - seg_lo(j) < kSieveSegmentSpan) ? hi : seg_lo(j) + kSieveSegmentSpan - 1;
+    }
+    bool emits_two() const { return lo <= 2 && hi >= 2; }
+};
+
+class PrimeRange : public std::ranges::view_interface<PrimeRange> {
+public:
+    class iterator {
+    public:
+        using value_type = std::uint64_t;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::input_iterator_tag;
+
+        iterator() = default;
+        std::uint64_t operator*() const noexcept { return value_; }
+        iterator& operator++() { advance(); return *this; }
+        void operator++(int) { advance(); }
+        friend bool operator==(const iterator& it, std::default_sentinel_t) noexcept { return it.done_; }
+
+    private:
+        friend class PrimeRange;
+        iterator(const PrimeRange* r) : plan_(r->plan_), base_(r->base_) {
+            if (plan_.segments == 0) { done_ = true; return; }
+            if (plan_.emits_two()) { value_ = 2; return; }
+            advance();
+        }
+
+        void advance() {
+            while (!cur_.next(value_)) {
+                if (next_seg_ == plan_.segments) { done_ = true; return; }
+                cur_.first = sieve_segment(plan_.seg_lo(next_seg_), plan_.seg_hi(next_seg_), *base_, cur_.seg);
+                cur_.i = 0;
+                ++next_seg_;
+            }
+        }
+
+        PrimeSegmentPlan plan_;
+        std::shared_ptr<const std::vector<std::uint32_t>> base_;
+        PrimeSegmentCursor cur_;
+        std::uint64_t next_seg_ = 0;
+        std::uint64_t value_ = 0;
+        bool done_ = false;
+    };
+
+    PrimeRange() = default;
+    PrimeRange(std::uint64_t lo, std::uint64_t hi)
+        : plan_(lo, hi), base_(std::make_shared<const std::vector<std::uint32_t>>(sieve_base_primes(hi))) {}
+
+    iterator begin() const { return iterator(this); }
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+    PrimeSegmentPlan plan_;
+    std::shared_ptr<const std::vector<std::uint32_t>> base_;
+};
+
+inline PrimeRange primes(std::uint64_t lo, std::uint64_t hi) { return PrimeRange(lo, hi); }
+
+class PrefetchedPrimeRange : public std::ranges::view_interface<PrefetchedPrimeRange> {
+    // Ring of `depth` buffers. Workers claim segments in order, but only
+    // while the claim stays within depth of what the consumer has taken, so
+    // with depth < threads the extra workers simply wait.
+    struct State {
+        PrimeSegmentPlan plan;
+        std::vector<std::uint32_t> base;
+        std::vector<PrimeSegmentCursor> slots;
+        std::vector<std::uint64_t> slot_seg;  // segment held by each slot, or kEmpty
+        std::uint64_t next_claim = 0;
+        std::uint64_t consumed = 0;
+        bool stop = false;
+        std::mutex m;
+        std::condition_variable ready_cv;
+        std::condition_variable space_cv;
+        std::vector<std::thread> workers;
+
+        static constexpr std::uint64_t kEmpty = ~std::uint64_t{0};
+
+        ~State() {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                stop = true;
+            }
+            space_cv.notify_all();
+            for (auto& th : workers) th.join();
+        }
+
+        void worker() {
+            std::unique_lock<std::mutex> lk(m);
+            for (;;) {
+                space_cv.wait(lk, [&]{
+                    return stop || next_claim == plan.segments || next_claim < consumed + slots.size();
+                });
+                if (stop || next_claim == plan.segments) return;
+                std::uint64_t j = next_claim++;
+                PrimeSegmentCursor& slot = slots[j % slots.size()];
+                lk.unlock();
+                slot.first = sieve_segment(plan.seg_lo(j), plan.seg_hi(j), base, slot.seg);
+                slot.i = 0;
+                lk.lock();
+                slot_seg[j % slots.size()] = j;
+                ready_cv.notify_all();
+            }
+        }
+
+        // Swaps segment j into cur once a worker has finished it.
+        void take(std::uint64_t j, PrimeSegmentCursor& cur) {
+            std::unique_lock<std::mutex> lk(m);
+            std::size_t s = j % slots.size();
+            ready_cv.wait(lk, [&]{ return slot_seg[s] == j; });
+            std::swap(cur, slots[s]);
+            slot_seg[s] = kEmpty;
+            consumed = j + 1;
+            lk.unlock();
+            space_cv.notify_all();
+        }
+    };
+
+public:
+    class iterator {
+    public:
+        using value_type = std::uint64_t;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::input_iterator_tag;
+
+        iterator() = default;
+        iterator(iterator&&) = default;
+        iterator& operator=(iterator&&) = default;
+        std::uint64_t operator*() const noexcept { return value_; }
+        iterator& operator++() { advance(); return *this; }
+        void operator++(int) { advance(); }
+        friend bool operator==(const iterator& it, std::default_sentinel_t) noexcept { return it.done_; }
+
+    private:
+        friend class PrefetchedPrimeRange;
+        explicit iterator(State* s) : s_(s) {
+            if (s_->plan.segments == 0) { done_ = true; return; }
+            if (s_->plan.emits_two()) { value_ = 2; return; }
+            advance();
+        }
+
+        void advance() {
+            while (!cur_.next(value_)) {
+                if (next_seg_ == s_->plan.segments) { done_ = true; return; }
+                s_->take(next_seg_++, cur_);
+            }
+        }
+
+        State* s_ = nullptr;
+        PrimeSegmentCursor cur_;
+        std::uint64_t next_seg_ = 0;
+        std::uint64_t value_ = 0;
+        bool done_ = false;
+    };
+
+    PrefetchedPrimeRange(std::uint64_t lo, std::uint64_t hi, unsigned threads, unsigned depth)
+        : s_(std::make_unique<State>()) {
+        threads = std::max(1u, threads);
+        s_->plan = PrimeSegmentPlan(lo, hi);
+        s_->base = sieve_base_primes(hi);
+        s_->slots.resize(std::max(1u, depth));
+        s_->slot_seg.assign(s_->slots.size(), State::kEmpty);
+        for (unsigned i = 0; i < threads; ++i) s_->workers.emplace_back([st = s_.get()]{ st->worker(); });
+    }
+
+    iterator begin() { return iterator(s_.get()); }
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+    std::unique_ptr<State> s_;
+};
+
+// depth = 0 picks two buffers per worker.
+inline PrefetchedPrimeRange parallel_primes(std::uint64_t lo, std::uint64_t hi,
+                                            unsigned threads = std::max(1u, std::thread::hardware_concurrency()),
+                                            unsigned depth = 0) {
+    return PrefetchedPrimeRange(lo, hi, threads, depth ? depth : 2 * std::max(1u, threads));
+}
+
+static_assert(std::ranges::input_range<PrimeRange>);
+static_assert(std::ranges::view<PrimeRange>);
+static_assert(std::ranges::input_range<PrefetchedPrimeRange>);
+
+#endif
@@ -0,0 +1,54 @@
+#include "primes.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+// primes() and parallel_primes() against for_each_prime over ranges that
+// start and end inside, at the edge of, and across segments, plus an early
+// break that must shut the prefetching workers down cleanly.
+int main() {
+    auto reference = [](std::uint64_t lo, std::uint64_t hi) {
+        std::vector<std::uint64_t> out;
+        std::vector<std::uint8_t> seg;
+        for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t p){ out.push_back(p); });
+        return out;
+    };
+    const std::uint64_t span = kSieveSegmentSpan;
+    const std::pair<std::uint64_t, std::uint64_t> ranges[] = {
+        {0, 0}, {0, 1}, {2, 2}, {3, 3}, {0, 100}, {5, 4}, {1, span}, {2, span + 1},
+        {span - 1, 3 * span + 7}, {1'000'000'000, 1'000'000'000 + 5 * span + 3},
+        {10'000'000'000'000ull, 10'000'000'000'000ull + 2 * span},
+    };
+    for (auto [lo, hi] : ranges) {
+        auto want = reference(lo, hi);
+        std::vector<std::uint64_t> got;
+        for (std::uint64_t p : primes(lo, hi)) got.push_back(p);
+        assert(got == want);
+        for (unsigned threads : {1u, 3u}) {
+            got.clear();
+            for (std::uint64_t p : parallel_primes(lo, hi, threads, threads + 1)) got.push_back(p);
+            assert(got == want);
+        }
+        // a ring shallower than the worker count
+        got.clear();
+        for (std::uint64_t p : parallel_primes(lo, hi, 4, 1)) got.push_back(p);
+        assert(got == want);
+    }
+
+    // The views compose with the standard range adaptors.
+    std::vector<std::uint64_t> sevens;
+    for (std::uint64_t p : primes(0, 1000) | std::views::filter([](std::uint64_t p){ return p % 10 == 7; })
+                                           | std::views::take(3))
+        sevens.push_back(p);
+    assert((sevens == std::vector<std::uint64_t>{7, 17, 37}));
+
+    // Stop early in a huge range; the destructor must stop workers that are
+    // blocked on a full ring.
+    std::uint64_t n = 0, last = 0;
+    for (std::uint64_t p : parallel_primes(1'000'000'000'000ull, 1'000'000'000'000'000ull, 2, 2)) {
+        last = p;
+        if (++n == 10'000) break;
+    }
+    assert(last == reference(1'000'000'000'000ull, 1'000'000'000'000ull + 300'000)[9'999]);
+    return 0;
+}
@@ -0,0 +1,233 @@
+#ifndef primeset_hpp
+#define primeset_hpp
+
+#include "helpers.hpp"
+
+#include <bit>
+#include <memory>
+
+// Mod-30 wheel bitset over [lo, hi]: each byte covers 30 integers and keeps
+// one bit per residue coprime to 30 (1, 7, 11, 13, 17, 19, 23, 29), so the
+// set costs hi/30 bytes no matter how many primes it holds. 2, 3 and 5 are
+// tracked separately. Bit i stands for base + 30 * (i / 8) + residue[i % 8].
+//
+// Fill with insert() (thread-safe: adjacent workers may share a word), then
+// call build_index() once; rank/select queries need the index.
+class PrimeSet {
+public:
+    static constexpr std::uint8_t kResidues[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+
+    PrimeSet(std::uint64_t lo, std::uint64_t hi)
+        : lo_(lo), hi_(hi), base_(lo / 30 * 30) {
+        std::uint64_t numbers = (hi >= base_) ? hi - base_ + 1 : 0;
+        nwords_ = static_cast<std::size_t>((numbers + 239) / 240);
+        words_ = std::make_unique<std::uint64_t[]>(nwords_);
+    }
+
+    // Leaves the words uninitialized for zero(words, count) to clear, so
+    // the threads that fill the set can also be the ones to first touch it.
+    template <class Zero>
+    PrimeSet(std::uint64_t lo, std::uint64_t hi, Zero&& zero)
+        : lo_(lo), hi_(hi), base_(lo / 30 * 30) {
+        std::uint64_t numbers = (hi >= base_) ? hi - base_ + 1 : 0;
+        nwords_ = static_cast<std::size_t>((numbers + 239) / 240);
+        words_ = std::make_unique_for_overwrite<std::uint64_t[]>(nwords_);
+        zero(words_.get(), nwords_);
+    }
+
+    std::uint64_t lo() const noexcept { return lo_; }
+    std::uint64_t hi() const noexcept { return hi_; }
+    std::size_t bytes() const noexcept { return nwords_ * sizeof(std::uint64_t) + blocks_.size() * sizeof(std::uint64_t); }
+
+    // Marks prime n (lo <= n <= hi). Safe to call concurrently.
+    void insert(std::uint64_t n) {
+        if (n < 7) {
+            std::atomic_ref<std::uint8_t>(small_).fetch_or(small_bit(n), std::memory_order_relaxed);
+            return;
+        }
+        std::uint64_t bit = bit_of(n);
+        std::atomic_ref<std::uint64_t>(words_[bit / 64])
+            .fetch_or(std::uint64_t{1} << (bit % 64), std::memory_order_relaxed);
+    }
+
+    bool contains(std::uint64_t n) const {
+        if (n < lo_ || n > hi_) return false;
+        if (n < 7) return (small_ & small_bit(n)) != 0;
+        int r = residue_index(n % 30);
+        if (r < 0) return false;
+        std::uint64_t bit = bit_of(n);
+        return (words_[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    // Cumulative counts per kBlockWords words; call after the last insert().
+    void build_index() {
+        blocks_.assign((nwords_ + kBlockWords - 1) / kBlockWords, 0);
+        std::uint64_t total = std::popcount(small_);
+        for (std::size_t w = 0; w < nwords_; ++w) {
+            if (w % kBlockWords == 0) blocks_[w / kBlockWords] = total;
+            total += std::popcount(words_[w]);
+        }
+        count_ = total;
+    }
+
+    std::uint64_t count() const noexcept { return count_; }
+
+    // Number of primes in the set that are <= x (pi(x) when the set starts at 2).
+    std::uint64_t rank(std::uint64_t x) const {
+        if (x < lo_) return 0;
+        if (x >= hi_) return count_;
+        std::uint64_t r = std::popcount(static_cast<std::uint8_t>(small_ & small_upto(x)));
+        if (x < 7 || x < base_) return r;
+        // bits strictly before the first residue > x
+        std::uint64_t bytes = (x - base_) / 30;
+        std::uint64_t in_byte = 0;
+        while (in_byte < 8 && base_ + bytes * 30 + kResidues[in_byte] <= x) ++in_byte;
+        std::uint64_t bit = bytes * 8 + in_byte;
+        std::size_t w = static_cast<std::size_t>(bit / 64);
+        if (w >= nwords_) return count_;
+        std::uint64_t total = blocks_[w / kBlockWords] - std::popcount(small_);
+        for (std::size_t i = w / kBlockWords * kBlockWords; i < w; ++i) total += std::popcount(words_[i]);
+        if (bit % 64) total += std::popcount(words_[w] & ((std::uint64_t{1} << (bit % 64)) - 1));
+        return r + total;
+    }
+
+    // k-th prime of the set, 1-based; 0 if k is out of range.
+    std::uint64_t nth(std::uint64_t k) const {
+        if (k == 0 || k > count_) return 0;
+        unsigned sm = std::popcount(small_);
+        if (k <= sm) {
+            std::uint8_t m = small_;
+            for (std::uint64_t i = 1; i < k; ++i) m &= m - 1;
+            return small_value(std::countr_zero(m));
+        }
+        // last block whose cumulative count is < k
+        auto it = std::lower_bound(blocks_.begin(), blocks_.end(), k);
+        std::size_t b = static_cast<std::size_t>(it - blocks_.begin()) - 1;
+        std::uint64_t seen = blocks_[b];
+        std::size_t w = b * kBlockWords;
+        for (;; ++w) {
+            unsigned c = std::popcount(words_[w]);
+            if (seen + c >= k) break;
+            seen += c;
+        }
+        std::uint64_t word = words_[w];
+        for (std::uint64_t i = seen + 1; i < k; ++i) word &= word - 1;
+        return value_of(static_cast<std::uint64_t>(w) * 64 + std::countr_zero(word));
+    }
+
+    // Smallest prime in the set > x, or 0.
+    std::uint64_t next(std::uint64_t x) const {
+        if (x >= hi_) return 0;
+        return nth(rank(x) + 1);
+    }
+
+    // Largest prime in the set < x, or 0.
+    std::uint64_t prev(std::uint64_t x) const {
+        if (x == 0) return 0;
+        return nth(rank(x - 1));
+    }
+
+    // ORs in wheel words for [first, first + 240 * n) laid out as in a set
+    // starting at 0 (first a multiple of 240); bits outside [lo, hi] are
+    // dropped. Not thread-safe: call before any insert().
+    void merge_wheel_words(std::uint64_t first, const std::uint64_t* src, std::size_t n) {
+        const std::int64_t off = wheel_offset(first);
+        for (std::size_t i = 0; i < n; ++i) {
+            std::uint64_t w = src[i];
+            std::int64_t bit = off + 64 * static_cast<std::int64_t>(i);
+            if (!w || bit <= -64) continue;
+            if (bit < 0) { w >>= -bit; bit = 0; }
+            std::size_t dw = static_cast<std::size_t>(bit / 64);
+            unsigned sh = static_cast<unsigned>(bit % 64);
+            if (dw >= nwords_) break;
+            words_[dw] |= w << sh;
+            if (sh && dw + 1 < nwords_) words_[dw + 1] |= w >> (64 - sh);
+        }
+        clear_outside();
+    }
+
+    // Inverse of merge_wheel_words: the set's wheel bits for [first, first + 240 * n).
+    void copy_wheel_words(std::uint64_t first, std::uint64_t* dst, std::size_t n) const {
+        const std::int64_t off = wheel_offset(first);
+        for (std::size_t i = 0; i < n; ++i) dst[i] = bits_at(off + 64 * static_cast<std::int64_t>(i));
+    }
+
+    // Calls fn(p) for every prime in ascending order.
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        for (unsigned i = 0; i < 3; ++i)
+            if (small_ & (1u << i)) fn(small_value(i));
+        for (std::size_t w = 0; w < nwords_; ++w) {
+            for (std::uint64_t word = words_[w]; word; word &= word - 1)
+                fn(value_of(static_cast<std::uint64_t>(w) * 64 + std::countr_zero(word)));
+        }
+    }
+
+private:
+    static constexpr std::size_t kBlockWords = 8;
+
+    static constexpr int residue_index(std::uint64_t r) {
+        switch (r) {
+            case 1: return 0; case 7: return 1; case 11: return 2; case 13: return 3;
+            case 17: return 4; case 19: return 5; case 23: return 6; case 29: return 7;
+            default: return -1;
+        }
+    }
+    static constexpr std::uint8_t small_bit(std::uint64_t n) {
+        return n == 2 ? 1 : n == 3 ? 2 : n == 5 ? 4 : 0;
+    }
+    static constexpr std::uint8_t small_upto(std::uint64_t x) {
+        return static_cast<std::uint8_t>((x >= 2 ? 1 : 0) | (x >= 3 ? 2 : 0) | (x >= 5 ? 4 : 0));
+    }
+    static constexpr std::uint64_t small_value(int i) { return i == 0 ? 2 : i == 1 ? 3 : 5; }
+
+    std::uint64_t bit_of(std::uint64_t n) const {
+        return (n - base_) / 30 * 8 + static_cast<std::uint64_t>(residue_index(n % 30));
+    }
+    std::uint64_t value_of(std::uint64_t bit) const {
+        return base_ + bit / 8 * 30 + kResidues[bit % 8];
+    }
+
+    // Bit of this set holding the first residue of an external word starting at first.
+    std::int64_t wheel_offset(std::uint64_t first) const {
+        return (static_cast<std::int64_t>(first) - static_cast<std::int64_t>(base_)) / 30 * 8;
+    }
+
+    // 64 bits starting at (possibly negative) bit index, zero outside the words.
+    std::uint64_t bits_at(std::int64_t bit) const {
+        if (bit <= -64 || bit >= static_cast<std::int64_t>(nwords_) * 64) return 0;
+        if (bit < 0) return words_[0] << -bit;
+        std::size_t w = static_cast<std::size_t>(bit / 64);
+        unsigned sh = static_cast<unsigned>(bit % 64);
+        std::uint64_t v = words_[w] >> sh;
+        if (sh && w + 1 < nwords_) v |= words_[w + 1] << (64 - sh);
+        return v;
+    }
+
+    // Clears wheel bits for numbers below lo or above hi.
+    void clear_outside() {
+        if (nwords_ == 0) return;
+        unsigned below = 0;
+        while (below < 8 && base_ + kResidues[below] < lo_) ++below;
+        words_[0] &= ~((std::uint64_t{1} << below) - 1);
+        std::uint64_t bytes = (hi_ - base_) / 30;
+        unsigned in_byte = 0;
+        while (in_byte < 8 && base_ + bytes * 30 + kResidues[in_byte] <= hi_) ++in_byte;
+        std::uint64_t end = bytes * 8 + in_byte;
+        std::size_t w = static_cast<std::size_t>(end / 64);
+        if (w >= nwords_) return;
+        if (end % 64) words_[w++] &= (std::uint64_t{1} << (end % 64)) - 1;
+        for (; w < nwords_; ++w) words_[w] = 0;
+    }
+
+    std::uint64_t lo_;
+    std::uint64_t hi_;
+    std::uint64_t base_;
+    std::size_t nwords_ = 0;
+    std::unique_ptr<std::uint64_t[]> words_;
+    std::vector<std::uint64_t> blocks_;
+    std::uint8_t small_ = 0;
+    std::uint64_t count_ = 0;
+};
+
+#endif
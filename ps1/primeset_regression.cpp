@@ -0,0 +1,54 @@
+#include "primeset.hpp"
+#include "sieve.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+namespace {
+
+// Fills a PrimeSet over [lo, hi] and checks every query against a plain list.
+void check_queries(std::uint64_t lo, std::uint64_t hi) {
+    std::vector<std::uint64_t> ref;
+    std::vector<std::uint8_t> seg;
+    for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t p){ ref.push_back(p); });
+
+    PrimeSet set(lo, hi);
+    for (auto it = ref.rbegin(); it != ref.rend(); ++it) set.insert(*it);
+    set.build_index();
+
+    assert(set.count() == ref.size());
+    std::vector<std::uint64_t> walked;
+    set.for_each([&](std::uint64_t p){ walked.push_back(p); });
+    assert(walked == ref);
+
+    for (std::size_t i = 0; i < ref.size(); ++i) assert(set.nth(i + 1) == ref[i]);
+    assert(set.nth(0) == 0);
+    assert(set.nth(ref.size() + 1) == 0);
+
+    std::uint64_t x_lo = lo > 3 ? lo - 3 : 0;
+    for (std::uint64_t x = x_lo; x <= hi + 3; ++x) {
+        auto ub = std::upper_bound(ref.begin(), ref.end(), x);
+        auto lb = std::lower_bound(ref.begin(), ref.end(), x);
+        assert(set.rank(x) == static_cast<std::uint64_t>(ub - ref.begin()));
+        assert(set.contains(x) == (lb != ref.end() && *lb == x));
+        assert(set.next(x) == (ub == ref.end() ? 0 : *ub));
+        assert(set.prev(x) == (lb == ref.begin() ? 0 : *(lb - 1)));
+    }
+}
+
+}
+int main() {
+    check_queries(2, 2);
+    check_queries(2, 3);
+    check_queries(2, 100);
+    check_queries(5, 7);
+    check_queries(2, 200'000);
+    check_queries(31, 2'000);
+    // word counts that are a multiple of the index block (8 words, 1920 numbers)
+    check_queries(2, 1'919);
+    check_queries(2, 3'839);
+    check_queries(31, 3'869);
+    check_queries(99'989, 131'071);
+    check_queries(1'000'000'007, 1'000'100'000);
+    return 0;
+}
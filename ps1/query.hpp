@@ -0,0 +1,132 @@
+#ifndef query_hpp
+#define query_hpp
+
+#include "count.hpp"
+#include "kernels.hpp"
+
+// Answers is_prime / next / prev / pi / nth queries from a resident
+// PrimeSet over [2, cfg.limit] (built by the sieve kernel, through the
+// cache when cfg.cache is set). Past the resident bound, is_prime/next/prev
+// fall back to deterministic Miller-Rabin, pi to Lucy_Hedgehog and nth to
+// pi at an estimate followed by a short sieve. Results are 0 where no
+// answer exists (prev(2), next past the largest 64-bit prime, nth(0)).
+// Lucy_Hedgehog needs O(sqrt(x)) memory, so pi and nth only count up to
+// cfg.pi_max past the resident set; larger ones answer kQueryRefused.
+enum class QueryOp : std::uint8_t { IsPrime = 1, Next, Prev, Pi, Nth };
+
+inline constexpr std::uint64_t kQueryRefused = UINT64_MAX;  // never a valid answer
+
+inline std::optional<QueryOp> parse_query_op(std::string_view s) {
+    if (s == "is_prime") return QueryOp::IsPrime;
+    if (s == "next" || s == "next_prime") return QueryOp::Next;
+    if (s == "prev" || s == "prev_prime") return QueryOp::Prev;
+    if (s == "pi") return QueryOp::Pi;
+    if (s == "nth" || s == "nth_prime") return QueryOp::Nth;
+    return std::nullopt;
+}
+
+class QueryEngine {
+public:
+    explicit QueryEngine(const Config& cfg)
+        : set_(build_resident(cfg)), pool_(cfg.threads), pi_max_(cfg.pi_max) {}
+
+    const PrimeSet& resident() const noexcept { return set_; }
+
+    std::uint64_t answer(QueryOp op, std::uint64_t x) {
+        const std::uint64_t r = set_.hi();
+        switch (op) {
+            case QueryOp::IsPrime:
+                return x <= r ? set_.contains(x) : is_prime_mr(x);
+            case QueryOp::Next: {
+                if (x < r) if (std::uint64_t p = set_.next(x)) return p;
+                for (std::uint64_t n = std::max(x, r) + 1; n > x; ++n)
+                    if (is_prime_mr(n)) return n;
+                return 0;  // wrapped past 2^64 - 1
+            }
+            case QueryOp::Prev: {
+                std::uint64_t n = x;
+                while (n > r + 1)
+                    if (is_prime_mr(--n)) return n;
+                return set_.prev(n);
+            }
+            case QueryOp::Pi:
+                return x <= r ? set_.rank(x) : count_to(x);
+            case QueryOp::Nth:
+                return x <= set_.count() ? set_.nth(x) : nth_beyond(x);
+        }
+        return 0;
+    }
+
+    // Answers n queries of one kind. Large batches that leave the resident
+    // range are split across the pool; while another connection holds the
+    // pool the batch runs on the caller.
+    void answer_batch(QueryOp op, const std::uint64_t* in, std::uint64_t* out, std::size_t n) {
+        constexpr std::size_t kParallelMin = 64;
+        bool heavy = op == QueryOp::IsPrime || op == QueryOp::Next || op == QueryOp::Prev;
+        bool beyond = false;
+        if (heavy && n >= kParallelMin && pool_.size() > 1)
+            for (std::size_t i = 0; i < n && !beyond; ++i) beyond = in[i] > set_.hi();
+        std::unique_lock<std::mutex> lk(pool_m_, std::defer_lock);
+        if (beyond && lk.try_lock()) {
+            unsigned k = pool_.size();
+            pool_.run(k, [&](unsigned idx){
+                auto s = compute_worker_slice(0, n, k, idx);
+                for (std::uint64_t i = s.begin; i < s.begin + s.count; ++i) out[i] = answer(op, in[i]);
+            });
+            return;
+        }
+        for (std::size_t i = 0; i < n; ++i) out[i] = answer(op, in[i]);
+    }
+
+private:
+    static PrimeSet build_resident(Config cfg) {
+        cfg.start = 2;
+        cfg.limit = std::max<std::uint64_t>(cfg.limit, 2);
+        return collect_primes(Kernel::Sieve, cfg);
+    }
+
+    // pi(x) on the pool unless a batch elsewhere holds it; refused past pi_max.
+    std::uint64_t count_to(std::uint64_t x) {
+        if (x > pi_max_) return kQueryRefused;
+        std::unique_lock<std::mutex> lk(pool_m_, std::try_to_lock);
+        return lk ? prime_pi(x, pool_) : prime_pi(x);
+    }
+
+    // k-th prime past the resident set: estimate p_k, count up to the
+    // estimate, then sieve forward or backward to the exact prime.
+    std::uint64_t nth_beyond(std::uint64_t k) {
+        long double lk = std::log(static_cast<long double>(k)), llk = std::log(lk);
+        long double est = k * (lk + llk - 1 + (llk - 2) / lk);
+        if (est >= 1.8e19L) return 0;
+        std::uint64_t x = std::max(set_.hi(), static_cast<std::uint64_t>(est));
+        std::uint64_t c = count_to(x);
+        if (c == kQueryRefused) return kQueryRefused;
+        constexpr std::uint64_t kWindow = 1u << 20;
+        std::vector<std::uint8_t> seg;
+        std::vector<std::uint64_t> found;
+        if (c < k) {
+            for (std::uint64_t lo = x + 1;; lo += kWindow) {
+                std::uint64_t hi = lo + kWindow - 1;
+                found.clear();
+                for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t p){ found.push_back(p); });
+                if (c + found.size() >= k) return found[k - c - 1];
+                c += found.size();
+            }
+        }
+        // c >= k: the answer is the (c - k + 1)-th prime counting down from x
+        for (std::uint64_t hi = x;; hi -= kWindow) {
+            std::uint64_t lo = hi >= kWindow ? hi - kWindow + 1 : 2;
+            found.clear();
+            for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t p){ found.push_back(p); });
+            if (c - found.size() < k) return found[k - (c - found.size()) - 1];
+            c -= found.size();
+        }
+    }
+
+    PrimeSet set_;
+    ForkJoinPool pool_;
+    std::mutex pool_m_;
+    std::uint64_t pi_max_;
+};
+
+#endif
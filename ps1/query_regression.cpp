@@ -0,0 +1,56 @@
+#include "query.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+// Checks every query kind against a plain sieve, inside and past a small
+// resident range, one at a time and through the pooled batch path.
+int main() {
+    Config cfg;
+    cfg.threads = 3;
+    cfg.limit = 10'000;
+    QueryEngine engine(cfg);
+
+    const std::uint64_t top = 300'000;
+    std::vector<std::uint64_t> primes;
+    std::vector<std::uint8_t> seg;
+    for_each_prime(2, top + 1000, sieve_base_primes(top + 1000), seg, [&](std::uint64_t p){ primes.push_back(p); });
+
+    for (std::uint64_t x = 0; x <= top; x += (x < 20'000 ? 1 : 7)) {
+        auto it = std::upper_bound(primes.begin(), primes.end(), x);
+        std::uint64_t pi = static_cast<std::uint64_t>(it - primes.begin());
+        assert(engine.answer(QueryOp::IsPrime, x) == (pi && primes[pi - 1] == x));
+        assert(engine.answer(QueryOp::Next, x) == *it);
+        std::uint64_t below = static_cast<std::uint64_t>(std::lower_bound(primes.begin(), primes.end(), x) - primes.begin());
+        assert(engine.answer(QueryOp::Prev, x) == (below ? primes[below - 1] : 0));
+        if (x % 997 == 0 || x <= 20'000) assert(engine.answer(QueryOp::Pi, x) == pi);
+    }
+    for (std::uint64_t k : {0ull, 1ull, 1229ull, 1230ull, 5000ull, 20'000ull, 25'997ull})
+        assert(engine.answer(QueryOp::Nth, k) == (k ? primes[k - 1] : 0));
+
+    std::vector<std::uint64_t> in, out(4096);
+    for (std::uint64_t i = 0; i < out.size(); ++i) in.push_back(i * 73);
+    engine.answer_batch(QueryOp::IsPrime, in.data(), out.data(), in.size());
+    for (std::size_t i = 0; i < in.size(); ++i)
+        assert(out[i] == std::binary_search(primes.begin(), primes.end(), in[i]));
+
+    assert(engine.answer(QueryOp::Next, 18'446'744'073'709'551'557ull) == 0);
+    assert(engine.answer(QueryOp::Prev, 18'446'744'073'709'551'615ull) == 18'446'744'073'709'551'557ull);
+    assert(engine.answer(QueryOp::Nth, 1'000'000) == 15'485'863);
+    assert(engine.answer(QueryOp::Pi, 1'000'000'000) == 50'847'534);
+
+    // counts past pi_max are refused instead of allocating O(sqrt(x)) tables
+    Config capped = cfg;
+    capped.pi_max = 1'000'000;
+    QueryEngine small(capped);
+    assert(small.answer(QueryOp::Pi, 1'000'000) == 78'498);
+    assert(small.answer(QueryOp::Pi, 1'000'001) == kQueryRefused);
+    assert(small.answer(QueryOp::Pi, 18'446'744'073'709'551'615ull) == kQueryRefused);
+    assert(small.answer(QueryOp::Nth, 1'000'000) == kQueryRefused);
+    assert(small.answer(QueryOp::Nth, 1000) == 7919);
+    assert(engine.answer(QueryOp::Pi, 18'446'744'073'709'551'615ull) == kQueryRefused);
+    std::vector<std::uint64_t> mixed{10, 18'446'744'073'709'551'615ull, 100}, got(3);
+    small.answer_batch(QueryOp::Pi, mixed.data(), got.data(), mixed.size());
+    assert(got[0] == 4 && got[1] == kQueryRefused && got[2] == 25);
+    return 0;
+}
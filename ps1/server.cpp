@@ -0,0 +1,297 @@
+#include "query.hpp"
+
+#include <charconv>
+#include <csignal>
+#include <random>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Long-running query server over a resident prime set (query.hpp).
+//
+//   ./server [--config=config.txt]                 serve stdin -> stdout
+//   ./server [--config=config.txt] --socket=PATH   serve a Unix socket
+//   ./server --connect=PATH --bench=N [--batch=1024] [--op=is_prime] [--max=X]
+//
+// threads, limit (the resident bound) and cache come from the config.
+// Text protocol, one batch per line: an op followed by its arguments,
+// answered by one line with the results in order.
+//   is_prime 7 8 9   ->  1 0 0
+//   next 100         ->  101
+//   prev 100         ->  97
+//   pi 1000000       ->  78498
+//   nth 1 2 3        ->  2 3 5
+//   info             ->  resident 2 <limit> <primes>
+// Unknown ops and bad numbers get "ERR <reason>", as does a line whose
+// evaluation fails; a pi/nth argument past pi_max gets "ERR" in its place
+// (pi 10 1e30 -> 4 ERR). Each reply is written as soon as its line is
+// answered. A connection whose first
+// byte is 0 switches to the binary protocol for its remaining bytes:
+//   request   u8 op (QueryOp), u8 pad[3], u32 count, u64 args[count]
+//   response  u32 count, u32 pad, u64 results[count]
+// all little-endian; refused or failed queries come back as 2^64 - 1
+// (kQueryRefused), which is never a valid answer. The client mode pushes N random binary queries and
+// reports the throughput.
+namespace {
+
+constexpr std::size_t kReadBytes = 1u << 16;
+constexpr std::uint32_t kMaxBatch = 1u << 20;
+
+bool write_all(int fd, const char* p, std::size_t n) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w;
+        n -= static_cast<std::size_t>(w);
+    }
+    return true;
+}
+
+bool read_all(int fd, void* dst, std::size_t n) {
+    char* p = static_cast<char*>(dst);
+    while (n > 0) {
+        ssize_t r = ::read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<std::size_t>(r);
+    }
+    return true;
+}
+
+struct BinaryRequest {
+    std::uint8_t op;
+    std::uint8_t pad[3];
+    std::uint32_t count;
+};
+
+struct BinaryResponse {
+    std::uint32_t count;
+    std::uint32_t pad;
+};
+
+void append_number(std::string& out, std::uint64_t v) {
+    char num[24];
+    auto [end, ec] = std::to_chars(num, num + sizeof(num), v);
+    out.append(num, end);
+}
+
+// One text line -> one reply line appended to out.
+void answer_line(QueryEngine& engine, std::string_view line, std::vector<std::uint64_t>& args,
+                 std::vector<std::uint64_t>& results, std::string& out) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.remove_suffix(1);
+    std::size_t pos = line.find_first_not_of(' ');
+    if (pos == std::string_view::npos) return;
+    line.remove_prefix(pos);
+    std::string_view word = line.substr(0, line.find(' '));
+    line.remove_prefix(word.size());
+
+    if (word == "info") {
+        out += "resident 2 ";
+        append_number(out, engine.resident().hi());
+        out += ' ';
+        append_number(out, engine.resident().count());
+        out += '\n';
+        return;
+    }
+    auto op = parse_query_op(word);
+    if (!op) { out += "ERR unknown op\n"; return; }
+
+    args.clear();
+    const char* p = line.data();
+    const char* end = line.data() + line.size();
+    while (p < end) {
+        if (*p == ' ') { ++p; continue; }
+        std::uint64_t v = 0;
+        auto [next, ec] = std::from_chars(p, end, v);
+        if (ec != std::errc() || (next < end && *next != ' ')) { out += "ERR bad number\n"; return; }
+        args.push_back(v);
+        p = next;
+    }
+    results.resize(args.size());
+    try {
+        engine.answer_batch(*op, args.data(), results.data(), args.size());
+    } catch (const std::exception& e) {
+        out += "ERR ";
+        out += e.what();
+        out += '\n';
+        return;
+    }
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        if (i) out += ' ';
+        if (results[i] == kQueryRefused) out += "ERR";
+        else append_number(out, results[i]);
+    }
+    out += '\n';
+}
+
+void serve_binary(QueryEngine& engine, int in_fd, int out_fd, std::string_view pending) {
+    std::vector<std::uint64_t> args, results;
+    auto take = [&](void* dst, std::size_t n) {
+        std::size_t from_pending = std::min(n, pending.size());
+        std::memcpy(dst, pending.data(), from_pending);
+        pending.remove_prefix(from_pending);
+        return read_all(in_fd, static_cast<char*>(dst) + from_pending, n - from_pending);
+    };
+    for (;;) {
+        BinaryRequest req{};
+        if (!take(&req, sizeof(req))) return;
+        if (req.count > kMaxBatch || req.op < 1 || req.op > 5) return;
+        args.resize(req.count);
+        results.resize(req.count);
+        if (!take(args.data(), req.count * sizeof(std::uint64_t))) return;
+        try {
+            engine.answer_batch(static_cast<QueryOp>(req.op), args.data(), results.data(), req.count);
+        } catch (const std::exception&) {
+            std::fill(results.begin(), results.end(), kQueryRefused);
+        }
+        BinaryResponse resp{req.count, 0};
+        if (!write_all(out_fd, reinterpret_cast<const char*>(&resp), sizeof(resp)) ||
+            !write_all(out_fd, reinterpret_cast<const char*>(results.data()), req.count * sizeof(std::uint64_t)))
+            return;
+    }
+}
+
+// Reads whole lines and writes each reply as soon as its line is answered,
+// so a slow or failing line never holds back the replies before it.
+void serve(QueryEngine& engine, int in_fd, int out_fd) {
+    std::string in, out;
+    std::vector<std::uint64_t> args, results;
+    std::vector<char> buf(kReadBytes);
+    bool first = true;
+    for (;;) {
+        ssize_t r = ::read(in_fd, buf.data(), buf.size());
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        in.append(buf.data(), static_cast<std::size_t>(r));
+        if (first) {
+            first = false;
+            if (in[0] == '\0') { serve_binary(engine, in_fd, out_fd, std::string_view(in).substr(1)); return; }
+        }
+        std::size_t start = 0;
+        for (std::size_t nl; (nl = in.find('\n', start)) != std::string::npos; start = nl + 1) {
+            std::string_view line(in.data() + start, nl - start);
+            if (line == "quit") return;
+            answer_line(engine, line, args, results, out);
+            if (!write_all(out_fd, out.data(), out.size())) return;
+            out.clear();
+        }
+        in.erase(0, start);
+    }
+    if (!in.empty()) answer_line(engine, in, args, results, out);
+    write_all(out_fd, out.data(), out.size());
+}
+
+int serve_socket(QueryEngine& engine, const std::string& path) {
+    int lfd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) { std::cerr << "[ERROR] socket path too long\n"; return 1; }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    ::unlink(path.c_str());
+    if (lfd < 0 || ::bind(lfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(lfd, 64) != 0) {
+        std::cerr << "[ERROR] cannot listen on " << path << ": " << std::strerror(errno) << '\n';
+        return 1;
+    }
+    std::cerr << "[SERVER] listening on " << path << '\n';
+    for (;;) {
+        int fd = ::accept(lfd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        std::thread([&engine, fd]{ serve(engine, fd, fd); ::close(fd); }).detach();
+    }
+    ::close(lfd);
+    return 0;
+}
+
+int run_client(const std::string& path, std::uint64_t total, std::uint32_t batch, QueryOp op, std::uint64_t max) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), std::min(path.size() + 1, sizeof(addr.sun_path) - 1));
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "[ERROR] cannot connect to " << path << ": " << std::strerror(errno) << '\n';
+        return 1;
+    }
+    std::mt19937_64 rng(12345);
+    std::uniform_int_distribution<std::uint64_t> dist(1, std::max<std::uint64_t>(max, 1));
+    std::vector<std::uint64_t> args(batch), results(batch);
+    const char hello = '\0';
+    write_all(fd, &hello, 1);
+
+    std::uint64_t sent = 0, checksum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    while (sent < total) {
+        std::uint32_t n = static_cast<std::uint32_t>(std::min<std::uint64_t>(batch, total - sent));
+        for (std::uint32_t i = 0; i < n; ++i) args[i] = dist(rng);
+        BinaryRequest req{static_cast<std::uint8_t>(op), {0, 0, 0}, n};
+        BinaryResponse resp{};
+        if (!write_all(fd, reinterpret_cast<const char*>(&req), sizeof(req)) ||
+            !write_all(fd, reinterpret_cast<const char*>(args.data()), n * sizeof(std::uint64_t)) ||
+            !read_all(fd, &resp, sizeof(resp)) || resp.count != n ||
+            !read_all(fd, results.data(), n * sizeof(std::uint64_t))) {
+            std::cerr << "[ERROR] connection lost\n";
+            return 1;
+        }
+        for (std::uint32_t i = 0; i < n; ++i) checksum += results[i];
+        sent += n;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[CLIENT] " << sent << " queries in " << secs * 1000 << " ms = "
+              << static_cast<std::uint64_t>(sent / secs) << " queries/s (checksum " << checksum << ")\n";
+    ::close(fd);
+    return 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::string config_path = "config.txt", socket_path, connect_path;
+    std::uint64_t bench = 1'000'000, max = 0;
+    std::uint32_t batch = 1024;
+    QueryOp op = QueryOp::IsPrime;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto eq = a.find('=');
+        std::string key = a.substr(0, eq), val = eq == std::string::npos ? "" : a.substr(eq + 1);
+        try {
+            if (key == "--config") config_path = val;
+            else if (key == "--socket") socket_path = val;
+            else if (key == "--connect") connect_path = val;
+            else if (key == "--bench") bench = static_cast<std::uint64_t>(std::stold(val));
+            else if (key == "--batch") batch = static_cast<std::uint32_t>(std::clamp<std::uint64_t>(std::stoull(val), 1, kMaxBatch));
+            else if (key == "--max") max = static_cast<std::uint64_t>(std::stold(val));
+            else if (key == "--op") {
+                auto o = parse_query_op(val);
+                if (!o) throw std::invalid_argument(val);
+                op = *o;
+            } else { std::cerr << "unknown option " << a << '\n'; return 2; }
+        } catch (...) {
+            std::cerr << "bad value for " << key << '\n';
+            return 2;
+        }
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    Config cfg = read_config_file(config_path).value_or(Config{});
+    cfg.threads = std::max(1u, cfg.threads);
+    if (!connect_path.empty()) return run_client(connect_path, bench, batch, op, max ? max : cfg.limit * 2);
+
+    // stdout carries replies in stdin mode, so startup logs go to stderr
+    auto t0 = std::chrono::steady_clock::now();
+    auto* saved_cout = std::cout.rdbuf(std::cerr.rdbuf());
+    QueryEngine engine(cfg);
+    std::cout.rdbuf(saved_cout);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    std::cerr << "[SERVER] resident [2, " << engine.resident().hi() << "]: " << engine.resident().count()
+              << " primes, " << engine.resident().bytes() << " bytes, built in " << ms << " ms\n";
+
+    if (!socket_path.empty()) return serve_socket(engine, socket_path);
+    serve(engine, STDIN_FILENO, STDOUT_FILENO);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "primefile.hpp"
+#include "shard.hpp"
+
+#include <csignal>
+
+// Multi-process prime search (shard.hpp).
+//
+//   ./shard [--config=config.txt] [--workers=4] [--shards=16] [--retries=3]
+//           [--socket=/tmp/primes-shard.sock] [--kernel=sieve|range|coop]
+//           [--fail-shard=K]
+//   ./shard --worker=PATH [--config=config.txt] [--kernel=sieve]
+//
+// The coordinator reads start, limit, threads (per worker), mode, format
+// and outfile from the config, starts --workers local copies of itself in
+// worker mode, and writes the merged primes like Variants 2, 4 and 5 (to
+// stdout or outfile). --workers=0 starts none and waits for workers started
+// by hand (e.g. on other hosts with the socket forwarded). --fail-shard=K
+// makes whichever worker gets shard K first exit halfway through it, to
+// exercise the retry path.
+namespace {
+
+std::optional<Kernel> parse_kernel(const std::string& s) {
+    if (s == "sieve") return Kernel::Sieve;
+    if (s == "range") return Kernel::RangeSplit;
+    if (s == "coop") return Kernel::Cooperative;
+    return std::nullopt;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::string config_path = "config.txt", worker_path, kernel_name = "sieve";
+    ShardOptions opt;
+    opt.socket = "/tmp/primes-shard-" + std::to_string(::getpid()) + ".sock";
+    opt.workers = 4;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto eq = a.find('=');
+        std::string key = a.substr(0, eq), val = eq == std::string::npos ? "" : a.substr(eq + 1);
+        try {
+            if (key == "--config") config_path = val;
+            else if (key == "--worker") worker_path = val;
+            else if (key == "--socket") opt.socket = val;
+            else if (key == "--kernel") { if (!parse_kernel(val)) throw std::invalid_argument(val); kernel_name = val; }
+            else if (key == "--workers") opt.workers = static_cast<unsigned>(std::stoul(val));
+            else if (key == "--shards") opt.shards = static_cast<unsigned>(std::stoul(val));
+            else if (key == "--retries") opt.retries = static_cast<unsigned>(std::stoul(val));
+            else if (key == "--fail-shard") opt.fail_shard = std::stoi(val);
+            else { std::cerr << "unknown option " << a << '\n'; return 2; }
+        } catch (...) {
+            std::cerr << "bad value for " << key << '\n';
+            return 2;
+        }
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    const Kernel kernel = *parse_kernel(kernel_name);
+
+    if (!worker_path.empty()) {
+        Config cfg = read_config_file(config_path).value_or(Config{});
+        cfg.threads = std::max(1u, cfg.threads);
+        return run_shard_worker(cfg, worker_path, kernel);
+    }
+
+    const auto cfg = load_config(config_path);
+    opt.count_only = cfg.mode == RunMode::Count;
+    print_line("[RUN START] " + now_timestamp());
+    auto t0 = std::chrono::steady_clock::now();
+
+    auto spawn = [&](const std::string& path) -> pid_t {
+        std::vector<std::string> args = {argv[0], "--worker=" + path, "--config=" + config_path, "--kernel=" + kernel_name};
+        pid_t pid = ::fork();
+        if (pid != 0) return pid;
+        std::vector<char*> cargs;
+        for (auto& s : args) cargs.push_back(s.data());
+        cargs.push_back(nullptr);
+        ::execv("/proc/self/exe", cargs.data());
+        ::_exit(127);
+    };
+
+    PrimeSink sink(cfg);
+    ShardReport report;
+    {
+        // the merged stream is in order, so analytics see it as one slice
+        AnalyticsSlice gaps(cfg.start);
+        report = run_shard_coordinator(cfg, opt, spawn, [&](std::uint64_t p){ sink.push(p); gaps.add(p); });
+    }
+    bool written = sink.close();
+    auto t1 = std::chrono::steady_clock::now();
+    print_line("[RUN END] " + now_timestamp());
+    if (!report.ok) {
+        print_line("[ERROR] " + report.error);
+        return 1;
+    }
+    std::ostringstream oss;
+    oss << "[SHARD] workers=" << opt.workers << " shards=" << report.shards << " retries=" << report.retries
+        << " respawned=" << report.respawned << " peak_buffered_shards=" << report.peak_buffered;
+    print_line(oss.str());
+    print_summary("Sharded", cfg, t1 - t0, static_cast<std::size_t>(report.primes));
+    return written ? 0 : 1;
+}
@@ -0,0 +1,347 @@
+#ifndef shard_hpp
+#define shard_hpp
+
+#include "kernels.hpp"
+
+#include <deque>
+#include <functional>
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Multi-process search. A coordinator splits [start, limit] into shards of
+// whole sieve segments (compute_aligned_slice) and listens on a Unix
+// socket; worker processes, local children or anything else that can reach
+// the socket, connect and run one shard at a time with the in-process
+// kernels. The protocol (native endian, one host):
+//   worker -> coordinator  ShardHello, then per shard ShardFrame + n primes
+//                          (ascending) until a frame with n = 0 carrying
+//                          the shard's total
+//   coordinator -> worker  ShardTask; kShardQuit ends the worker
+// A worker that disconnects mid-shard (crash, kill, lost host) has its
+// shard requeued, up to `retries` times per shard, and a local child is
+// replaced. Shards are disjoint and ascending, so the k-way merge of their
+// streams is a drain of the lowest unfinished shard: its primes go out as
+// they arrive, later shards are buffered, and at most `window` shards past
+// it are handed out. A retried head shard skips the primes it already emitted.
+constexpr std::uint32_t kShardMagic = 0x44485350;  // "PSHD"
+constexpr std::uint32_t kShardQuit = 1;
+constexpr std::uint32_t kShardCountOnly = 2;
+constexpr std::uint32_t kShardFail = 4;    // fault injection: exit halfway through this shard
+constexpr std::uint32_t kShardFramePrimes = 8192;
+
+struct ShardHello {
+    std::uint32_t magic;
+    std::int32_t pid;
+};
+
+struct ShardTask {
+    std::uint32_t id;
+    std::uint32_t flags;
+    std::uint64_t lo;
+    std::uint64_t hi;
+};
+
+struct ShardFrame {
+    std::uint32_t id;
+    std::uint32_t n;       // primes following; 0 ends the shard
+    std::uint64_t total;   // primes in the shard, in the end frame
+};
+
+// MSG_NOSIGNAL: a closed peer fails the send with EPIPE instead of raising
+// SIGPIPE, whatever the caller's signal setup (where the flag exists)
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+inline bool shard_write(int fd, const void* src, std::size_t n) {
+    const char* p = static_cast<const char*>(src);
+    while (n > 0) {
+        ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<std::size_t>(w);
+    }
+    return true;
+}
+
+inline bool shard_read(int fd, void* dst, std::size_t n) {
+    char* p = static_cast<char*>(dst);
+    while (n > 0) {
+        ssize_t r = ::read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<std::size_t>(r);
+    }
+    return true;
+}
+
+inline bool shard_address(const std::string& path, sockaddr_un& addr) {
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Worker loop: connects to the coordinator and serves shards until told to
+// quit. Fault injection: when the task carries kShardFail, or die_on(shard
+// id) is true, the worker exits halfway through streaming that shard.
+inline int run_shard_worker(const Config& base, const std::string& path, Kernel kernel,
+                            const std::function<bool(std::uint32_t)>& die_on = {}) {
+    sockaddr_un addr;
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || !shard_address(path, addr) ||
+        ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "[ERROR] worker cannot connect to " << path << ": " << std::strerror(errno) << '\n';
+        return 1;
+    }
+    ShardHello hello{kShardMagic, static_cast<std::int32_t>(::getpid())};
+    if (!shard_write(fd, &hello, sizeof(hello))) return 1;
+
+    Config cfg = base;
+    cfg.cache.clear();
+    std::vector<std::uint64_t> frame;
+    frame.reserve(kShardFramePrimes);
+    for (ShardTask task{}; shard_read(fd, &task, sizeof(task)); ) {
+        if (task.flags & kShardQuit) break;
+        cfg.start = task.lo;
+        cfg.limit = task.hi;
+        PrimeSet primes = collect_primes(kernel, cfg);
+        const bool die = (task.flags & kShardFail) || (die_on && die_on(task.id));
+        bool ok = true;
+        std::uint64_t sent = 0;
+        auto flush = [&]{
+            ShardFrame f{task.id, static_cast<std::uint32_t>(frame.size()), 0};
+            ok = ok && shard_write(fd, &f, sizeof(f)) &&
+                 shard_write(fd, frame.data(), frame.size() * sizeof(std::uint64_t));
+            sent += frame.size();
+            frame.clear();
+            if (die && sent * 2 >= primes.count()) ::_exit(3);
+        };
+        if (!(task.flags & kShardCountOnly)) {
+            primes.for_each([&](std::uint64_t p){
+                frame.push_back(p);
+                if (frame.size() == kShardFramePrimes) flush();
+            });
+            if (!frame.empty()) flush();
+        }
+        if (die) ::_exit(3);
+        ShardFrame end{task.id, 0, primes.count()};
+        if (!ok || !shard_write(fd, &end, sizeof(end))) break;
+    }
+    ::close(fd);
+    return 0;
+}
+
+struct ShardOptions {
+    std::string socket;
+    unsigned workers = 2;     // local children to start
+    unsigned shards = 0;      // 0 = 4 per worker
+    unsigned retries = 3;     // per shard
+    unsigned window = 0;      // shards handed out past the lowest unfinished one; 0 = 2 per worker
+    bool count_only = false;
+    int fail_shard = -1;      // first attempt of this shard gets kShardFail
+};
+
+struct ShardReport {
+    bool ok = true;
+    std::string error;
+    std::uint64_t primes = 0;
+    unsigned shards = 0;
+    unsigned retries = 0;
+    unsigned respawned = 0;
+    unsigned peak_buffered = 0;  // shards holding buffered primes at once
+};
+
+// Runs [cfg.start, cfg.limit] across workers. spawn(socket_path) starts one
+// local worker and returns its pid (or -1); on_prime(p) receives every prime
+// in ascending order unless opt.count_only.
+template <class Spawn, class OnPrime>
+inline ShardReport run_shard_coordinator(const Config& cfg, const ShardOptions& opt, Spawn&& spawn, OnPrime&& on_prime) {
+    ShardReport report;
+    auto fail = [&](std::string why) { report.ok = false; report.error = std::move(why); return report; };
+
+    struct Shard {
+        WorkerSlice range;
+        bool done = false;
+        unsigned attempts = 0;
+        std::uint64_t received = 0;   // this attempt
+        std::uint64_t emitted = 0;    // across attempts
+        std::uint64_t total = 0;
+        std::vector<std::uint64_t> buf;
+    };
+    std::uint64_t total = cfg.limit >= cfg.start ? cfg.limit - cfg.start + 1 : 0;
+    unsigned nshards = opt.shards ? opt.shards : 4 * std::max(1u, opt.workers);
+    std::vector<Shard> shards;
+    for (unsigned i = 0; i < nshards; ++i) {
+        WorkerSlice s = compute_aligned_slice(cfg.start, total, nshards, i, kSieveSegmentSpan);
+        if (s.count == 0) continue;
+        shards.emplace_back();
+        shards.back().range = s;
+    }
+    report.shards = static_cast<unsigned>(shards.size());
+    const std::size_t window = opt.window ? opt.window : 2 * std::max(1u, opt.workers);
+
+    sockaddr_un addr;
+    int lfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lfd < 0 || !shard_address(opt.socket, addr)) return fail("bad socket path " + opt.socket);
+    ::unlink(opt.socket.c_str());
+    if (::bind(lfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(lfd, 64) != 0) {
+        ::close(lfd);
+        return fail("cannot listen on " + opt.socket + ": " + std::strerror(errno));
+    }
+
+    struct Peer {
+        int fd;
+        pid_t pid;
+        int shard = -1;
+    };
+    std::vector<Peer> peers;
+    std::vector<pid_t> spawned, children, connected;  // every local pid / not yet reaped / ever connected
+    const unsigned respawn_budget = opt.retries * std::max(1u, opt.workers);
+    auto start_worker = [&] {
+        if (pid_t pid = spawn(opt.socket); pid > 0) {
+            spawned.push_back(pid);
+            children.push_back(pid);
+        }
+    };
+    auto respawn = [&] {
+        if (report.respawned >= respawn_budget) return;
+        ++report.respawned;
+        start_worker();
+    };
+    auto has = [](const std::vector<pid_t>& v, pid_t pid) { return std::find(v.begin(), v.end(), pid) != v.end(); };
+    for (unsigned i = 0; i < opt.workers; ++i) start_worker();
+
+    std::deque<std::size_t> pending;
+    for (std::size_t i = 0; i < shards.size(); ++i) pending.push_back(i);
+    std::size_t head = 0;
+
+    auto drop = [&](std::size_t i) -> bool {
+        Peer p = peers[i];
+        peers.erase(peers.begin() + static_cast<std::ptrdiff_t>(i));
+        ::close(p.fd);
+        if (p.shard >= 0) {
+            Shard& s = shards[static_cast<std::size_t>(p.shard)];
+            if (++s.attempts > opt.retries) return false;
+            ++report.retries;
+            s.received = 0;
+            s.buf.clear();
+            pending.push_front(static_cast<std::size_t>(p.shard));
+            print_line("[SHARD] worker " + std::to_string(p.pid) + " lost; retrying shard " + std::to_string(p.shard));
+        }
+        if (has(spawned, p.pid)) {
+            if (has(children, p.pid)) {
+                ::waitpid(p.pid, nullptr, 0);
+                children.erase(std::find(children.begin(), children.end(), p.pid));
+            }
+            respawn();
+        }
+        return true;
+    };
+
+    std::vector<std::uint64_t> in;
+    std::string failure;
+    while (head < shards.size() && failure.empty()) {
+        for (Peer& p : peers) {
+            if (p.shard >= 0 || pending.empty()) continue;
+            auto it = std::min_element(pending.begin(), pending.end());
+            if (*it >= head + window) break;
+            std::size_t id = *it;
+            pending.erase(it);
+            std::uint32_t flags = opt.count_only ? kShardCountOnly : 0;
+            if (static_cast<int>(id) == opt.fail_shard && shards[id].attempts == 0) flags |= kShardFail;
+            ShardTask t{static_cast<std::uint32_t>(id), flags,
+                        shards[id].range.begin, shards[id].range.begin + shards[id].range.count - 1};
+            p.shard = static_cast<int>(id);
+            shard_write(p.fd, &t, sizeof(t));  // a dead peer shows up as EOF below
+        }
+        if (opt.workers > 0 && peers.empty() && children.empty()) { failure = "no workers left"; break; }
+
+        std::vector<pollfd> fds{{lfd, POLLIN, 0}};
+        for (const Peer& p : peers) fds.push_back({p.fd, POLLIN, 0});
+        if (::poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) { failure = "poll failed"; break; }
+        // a child that dies before connecting never produces an EOF
+        for (pid_t pid; !children.empty() && (pid = ::waitpid(-1, nullptr, WNOHANG)) > 0; ) {
+            if (!has(children, pid)) continue;
+            children.erase(std::find(children.begin(), children.end(), pid));
+            if (!has(connected, pid)) respawn();
+        }
+
+        for (std::size_t i = fds.size(); i-- > 1; ) {
+            if (!fds[i].revents) continue;
+            Peer& p = peers[i - 1];
+            ShardFrame f{};
+            bool ok = shard_read(p.fd, &f, sizeof(f)) && static_cast<int>(f.id) == p.shard;
+            if (ok && f.n) {
+                in.resize(f.n);
+                ok = shard_read(p.fd, in.data(), f.n * sizeof(std::uint64_t));
+            }
+            if (!ok) {
+                const int lost = p.shard;
+                if (!drop(i - 1)) failure = "shard " + std::to_string(lost) + " failed too often";
+                continue;
+            }
+            Shard& s = shards[f.id];
+            if (f.n == 0) {
+                s.done = true;
+                s.total = f.total;
+                p.shard = -1;
+                continue;
+            }
+            for (std::uint64_t v : in) {
+                if (s.received++ < s.emitted) continue;  // sent out before a retry
+                if (f.id == head) { on_prime(v); ++s.emitted; }
+                else s.buf.push_back(v);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = ::accept4(lfd, nullptr, nullptr, SOCK_CLOEXEC);
+            ShardHello h{};
+            if (fd >= 0 && shard_read(fd, &h, sizeof(h)) && h.magic == kShardMagic) {
+                peers.push_back({fd, h.pid});
+                connected.push_back(h.pid);
+            } else if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+
+        unsigned buffered = 0;
+        for (std::size_t i = head; i < shards.size() && i < head + window; ++i) buffered += !shards[i].buf.empty();
+        report.peak_buffered = std::max(report.peak_buffered, buffered);
+        while (head < shards.size()) {
+            Shard& s = shards[head];
+            for (std::uint64_t v : s.buf) on_prime(v);
+            s.emitted += s.buf.size();
+            s.buf.clear();
+            s.buf.shrink_to_fit();
+            if (!s.done) break;
+            if (!opt.count_only && s.emitted != s.total) { failure = "shard " + std::to_string(head) + " lost primes"; break; }
+            report.primes += s.total;
+            ++head;
+        }
+    }
+
+    // local workers still starting up are not needed any more; stop them
+    // before they find the socket gone
+    for (pid_t pid : children)
+        if (!has(connected, pid)) ::kill(pid, SIGKILL);
+    ShardTask quit{0, kShardQuit, 0, 0};
+    for (Peer& p : peers) {
+        shard_write(p.fd, &quit, sizeof(quit));
+        ::close(p.fd);
+    }
+    // closing the listener first resets workers still queued in accept
+    ::close(lfd);
+    ::unlink(opt.socket.c_str());
+    for (pid_t pid : children) ::waitpid(pid, nullptr, 0);
+    if (!failure.empty()) return fail(failure);
+    return report;
+}
+
+#endif
@@ -0,0 +1,76 @@
+#include "shard.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <sys/mman.h>
+
+// Coordinator and forked local workers: ordered output and counts against
+// one in-process sieve, with workers that die halfway through the head
+// shard and a later shard, plus the aligned shard split itself.
+namespace {
+
+std::vector<std::uint64_t> reference(std::uint64_t lo, std::uint64_t hi) {
+    std::vector<std::uint64_t> out;
+    std::vector<std::uint8_t> seg;
+    for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t p){ out.push_back(p); });
+    return out;
+}
+
+}
+int main() {
+    // aligned shards tile the range, and all but the last are whole units
+    for (unsigned parts : {1u, 3u, 7u, 50u}) {
+        std::uint64_t next = 1000;
+        for (unsigned i = 0; i < parts; ++i) {
+            WorkerSlice s = compute_aligned_slice(1000, 1'000'000, parts, i, kSieveSegmentSpan);
+            if (s.count == 0) continue;
+            assert(s.begin == next && (s.begin - 1000) % kSieveSegmentSpan == 0);
+            next = s.begin + s.count;
+        }
+        assert(next == 1'001'000);
+    }
+
+    Config cfg;
+    cfg.threads = 2;
+    cfg.start = 1000;
+    cfg.limit = 5'000'000;
+    const std::string path = "/tmp/shard_regression_" + std::to_string(::getpid()) + ".sock";
+    // failures[id] > 0: the next worker to get shard id dies halfway through
+    // it. Shared with the forked workers, so each failure happens once.
+    auto* failures = static_cast<std::atomic<int>*>(::mmap(nullptr, 64 * sizeof(std::atomic<int>),
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    assert(failures != MAP_FAILED);
+    auto spawn = [&](const std::string& p) -> pid_t {
+        pid_t pid = ::fork();
+        if (pid != 0) return pid;
+        for (int fd = 3; fd < 256; ++fd) ::close(fd);
+        ::_exit(run_shard_worker(cfg, p, Kernel::Sieve, [&](std::uint32_t id){
+            return failures[id].fetch_sub(1) > 0;
+        }));
+    };
+    failures[0] = 1;
+    failures[5] = 1;
+
+    ShardOptions opt;
+    opt.socket = path;
+    opt.workers = 3;
+    opt.shards = 13;
+    std::vector<std::uint64_t> got;
+    ShardReport r = run_shard_coordinator(cfg, opt, spawn, [&](std::uint64_t p){ got.push_back(p); });
+    auto want = reference(cfg.start, cfg.limit);
+    assert(r.ok && r.retries == 2 && r.respawned == 2);
+    assert(got == want && r.primes == want.size());
+
+    opt.count_only = true;
+    opt.workers = 2;
+    got.clear();
+    r = run_shard_coordinator(cfg, opt, spawn, [&](std::uint64_t p){ got.push_back(p); });
+    assert(r.ok && r.retries == 0 && got.empty() && r.primes == want.size());
+
+    // a shard that keeps killing its worker fails the run instead of looping
+    opt.retries = 1;
+    failures[2] = 1000;
+    r = run_shard_coordinator(cfg, opt, spawn, [](std::uint64_t){});
+    assert(!r.ok);
+    return 0;
+}
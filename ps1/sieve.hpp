@@ -0,0 +1,140 @@
+#ifndef sieve_hpp
+#define sieve_hpp
+
+#include "helpers.hpp"
+
+#include <array>
+#include <cstring>
+
+// One byte per odd number; 64 KiB of flags covers 128Ki integers and stays
+// resident in L2 (and mostly L1) while the base primes stream over it.
+constexpr std::uint64_t kSieveSegmentBytes = 1u << 16;
+constexpr std::uint64_t kSieveSegmentSpan = 2 * kSieveSegmentBytes;
+
+// The odd primes below 2^16, sieved at compile time. They are every base
+// prime a range below 2^32 needs.
+constexpr std::uint32_t kSmallPrimeBound = 1u << 16;
+constexpr std::size_t kSmallPrimeCount = 6541;
+
+constexpr std::array<std::uint32_t, kSmallPrimeCount> make_small_primes() {
+    std::array<std::uint32_t, kSmallPrimeCount> out{};
+    std::array<bool, kSmallPrimeBound / 2> composite{};  // index i stands for 2i + 1
+    for (std::uint32_t i = 1; (2 * i + 1) * (2 * i + 1) < kSmallPrimeBound; ++i) {
+        if (composite[i]) continue;
+        std::uint32_t p = 2 * i + 1;
+        for (std::uint32_t j = p * p / 2; j < kSmallPrimeBound / 2; j += p) composite[j] = true;
+    }
+    std::size_t n = 0;
+    for (std::uint32_t i = 1; i < kSmallPrimeBound / 2; ++i)
+        if (!composite[i]) out[n++] = 2 * i + 1;
+    return out;
+}
+
+inline constexpr std::array<std::uint32_t, kSmallPrimeCount> kSmallPrimes = make_small_primes();
+static_assert(kSmallPrimes[kSmallPrimeCount - 1] == 65521);
+
+// Odd-only wheel of 3, 5, 7, 11 and 13: byte j is 0 iff 2j + 1 has one of
+// them as a factor. Segments start from a copy of it, so the base loop
+// skips the five primes that would cost the most stores.
+constexpr std::size_t kPresievePrimes = 5;
+constexpr std::size_t kPresievePeriod = 3 * 5 * 7 * 11 * 13;
+
+constexpr std::array<std::uint8_t, kPresievePeriod> make_presieve() {
+    std::array<std::uint8_t, kPresievePeriod> w{};
+    for (std::size_t j = 0; j < kPresievePeriod; ++j) {
+        std::size_t n = 2 * j + 1;
+        w[j] = (n % 3 && n % 5 && n % 7 && n % 11 && n % 13) ? 1 : 0;
+    }
+    return w;
+}
+
+inline constexpr std::array<std::uint8_t, kPresievePeriod> kPresieve = make_presieve();
+
+// Sieves the odd numbers of [lo, hi]. On return seg[i] != 0 iff first + 2*i is
+// prime, where first is the returned value. `base` must hold every odd prime p
+// with p*p <= hi, in ascending order; its first five entries (3 to 13) are
+// left to kPresieve. U is the width the per-prime start
+// offsets are computed in; sieve_segment() picks 32 bits when hi < 2^32.
+template <class U>
+inline std::uint64_t sieve_segment_as(U lo, U hi, const std::vector<std::uint32_t>& base,
+                                      std::vector<std::uint8_t>& seg) {
+    U first = lo | 1;
+    if (first > hi) { seg.clear(); return first; }
+    std::size_t len = static_cast<std::size_t>((hi - first) / 2) + 1;
+    seg.resize(len);
+    std::size_t w = static_cast<std::size_t>((first / 2) % kPresievePeriod);
+    for (std::size_t i = 0; i < len; ) {
+        std::size_t n = std::min(len - i, kPresievePeriod - w);
+        std::memcpy(seg.data() + i, kPresieve.data() + w, n);
+        i += n;
+        w = 0;
+    }
+    for (std::size_t k = 0; k < kPresievePrimes; ++k)
+        if (kSmallPrimes[k] >= first && kSmallPrimes[k] <= hi) seg[(kSmallPrimes[k] - first) / 2] = 1;
+    for (std::size_t k = kPresievePrimes; k < base.size(); ++k) {
+        std::uint64_t pp64 = std::uint64_t{base[k]} * base[k];
+        if (pp64 > hi) break;
+        U p = static_cast<U>(base[k]);
+        U pp = static_cast<U>(pp64);
+        // first odd multiple of p at or above max(first, p*p)
+        U m;
+        if (pp >= first) m = pp;
+        else {
+            U r = first % p;
+            m = r ? first + (p - r) : first;
+            if ((m & 1) == 0) m += p;
+        }
+        for (std::size_t i = static_cast<std::size_t>((m - first) / 2); i < len; i += p) seg[i] = 0;
+    }
+    if (first == 1) seg[0] = 0;
+    return first;
+}
+
+inline std::uint64_t sieve_segment(std::uint64_t lo, std::uint64_t hi,
+                                   const std::vector<std::uint32_t>& base,
+                                   std::vector<std::uint8_t>& seg) {
+    if (hi <= 0xffffffffu)
+        return sieve_segment_as<std::uint32_t>(static_cast<std::uint32_t>(lo), static_cast<std::uint32_t>(hi), base, seg);
+    return sieve_segment_as<std::uint64_t>(lo, hi, base, seg);
+}
+
+// Odd primes up to isqrt(limit). Below 2^32 that is a prefix of
+// kSmallPrimes; above it a sieve over the small primes covers
+// [2^16, isqrt(limit)].
+inline std::vector<std::uint32_t> sieve_base_primes(std::uint64_t limit) {
+    std::uint64_t r = isqrt64(limit);
+    auto small_end = std::upper_bound(kSmallPrimes.begin(), kSmallPrimes.end(), r);
+    std::vector<std::uint32_t> base(kSmallPrimes.begin(), small_end);
+    if (r < kSmallPrimeBound) return base;
+
+    std::vector<std::uint32_t> tiny(kSmallPrimes.begin(), kSmallPrimes.end());
+    std::vector<std::uint8_t> seg;
+    for (std::uint64_t lo = kSmallPrimeBound; lo <= r; lo += kSieveSegmentSpan) {
+        std::uint64_t hi = std::min(r, lo + kSieveSegmentSpan - 1);
+        std::uint64_t first = sieve_segment(lo, hi, tiny, seg);
+        for (std::size_t i = 0; i < seg.size(); ++i)
+            if (seg[i]) base.push_back(static_cast<std::uint32_t>(first + 2 * i));
+    }
+    return base;
+}
+
+// Calls fn(p) for every prime p in [lo, hi] in ascending order, sieving one
+// cache-sized segment at a time. `seg` is caller-owned scratch so each worker
+// reuses a single buffer.
+template <class Fn>
+inline void for_each_prime(std::uint64_t lo, std::uint64_t hi,
+                           const std::vector<std::uint32_t>& base,
+                           std::vector<std::uint8_t>& seg, Fn&& fn) {
+    if (lo > hi) return;
+    if (lo <= 2 && hi >= 2) fn(std::uint64_t{2});
+    for (std::uint64_t seg_lo = lo; seg_lo <= hi; ) {
+        std::uint64_t seg_hi = (hi - seg_lo < kSieveSegmentSpan) ? hi : seg_lo + kSieveSegmentSpan - 1;
+        std::uint64_t first = sieve_segment(seg_lo, seg_hi, base, seg);
+        for (std::size_t i = 0; i < seg.size(); ++i)
+            if (seg[i]) fn(first + 2 * i);
+        if (seg_hi == hi) break;
+        seg_lo = seg_hi + 1;
+    }
+}
+
+#endif
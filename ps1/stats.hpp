@@ -0,0 +1,244 @@
+#ifndef stats_hpp
+#define stats_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Per-worker run counters, enabled with stats=on (or stats=perf to add
+// hardware counters). A worker thread attaches to the slot for its index.
+// Hot paths then reach their own cache-line-sized slot through a
+// thread-local pointer, which is null when stats are off, so the only
+// cost when disabled is one branch. Counters are written by their owner
+// only and read after the workers have joined. Hardware counters need
+// perf_event_open, so stats=perf reports them as unavailable off Linux.
+enum class StatsMode { Off, On, Perf };
+
+struct alignas(64) WorkerStats {
+    std::uint64_t candidates = 0;   // numbers tested (or sieved)
+    std::uint64_t divisions = 0;    // trial divisor checks, vector lanes included
+    std::uint64_t primes = 0;
+    std::uint64_t busy_ns = 0;      // working, including lock waits while working
+    std::uint64_t lock_wait_ns = 0; // cout_mutex and output queue
+    std::uint64_t first_ns = 0;     // first attach / last detach, from enable()
+    std::uint64_t last_ns = 0;
+    std::uint64_t cycles = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t cache_misses = 0;
+    int perf_fd[3] = {-1, -1, -1};  // group leader first
+    bool used = false;
+};
+
+inline thread_local WorkerStats* tls_worker_stats = nullptr;
+
+inline WorkerStats* current_stats() noexcept { return tls_worker_stats; }
+
+class RunStats {
+public:
+    static RunStats& get() {
+        static RunStats s;
+        return s;
+    }
+
+    void enable(StatsMode mode) {
+        mode_ = mode;
+        t0_ = std::chrono::steady_clock::now();
+    }
+    bool enabled() const noexcept { return mode_ != StatsMode::Off; }
+    StatsMode mode() const noexcept { return mode_; }
+
+    std::uint64_t now_ns() const {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0_).count());
+    }
+
+    WorkerStats* slot(unsigned idx) {
+        std::lock_guard<std::mutex> lk(m_);
+        while (slots_.size() <= idx) slots_.push_back(std::make_unique<WorkerStats>());
+        return slots_[idx].get();
+    }
+
+    void perf_failed(int err) { perf_failed(std::strerror(err)); }
+    void perf_failed(const char* why) {
+        std::lock_guard<std::mutex> lk(m_);
+        if (perf_error_.empty()) perf_error_ = why;
+    }
+
+    // One JSON object: run-level fields, then one entry per worker slot.
+    // idle = kernel span - busy, where the span runs from the first attach
+    // to the last detach of any worker.
+    std::string json(const char* title) const {
+        std::uint64_t span0 = ~std::uint64_t{0}, span1 = 0, busy_max = 0, busy_sum = 0;
+        unsigned used = 0;
+        for (const auto& w : slots_) {
+            if (!w->used) continue;
+            span0 = std::min(span0, w->first_ns);
+            span1 = std::max(span1, w->last_ns);
+            busy_max = std::max(busy_max, w->busy_ns);
+            busy_sum += w->busy_ns;
+            ++used;
+        }
+        if (used == 0) span0 = 0;
+        auto ms = [](std::uint64_t ns){ return static_cast<double>(ns) / 1e6; };
+        std::ostringstream o;
+        o << "{\"variant\":\"" << title << "\",\"kernel_ms\":" << ms(span1 - span0)
+          << ",\"imbalance\":" << (busy_sum ? static_cast<double>(busy_max) * used / busy_sum : 1.0)
+          << ",\"perf\":";
+        if (mode_ != StatsMode::Perf) o << "\"off\"";
+        else if (!perf_error_.empty()) o << "\"unavailable: " << perf_error_ << '"';
+        else o << "\"on\"";
+        o << ",\"workers\":[";
+        bool first = true;
+        for (std::size_t i = 0; i < slots_.size(); ++i) {
+            const WorkerStats& w = *slots_[i];
+            if (!w.used) continue;
+            o << (first ? "" : ",") << "{\"worker\":" << i << ",\"candidates\":" << w.candidates
+              << ",\"divisions\":" << w.divisions << ",\"primes\":" << w.primes
+              << ",\"busy_ms\":" << ms(w.busy_ns)
+              << ",\"idle_ms\":" << ms((span1 - span0) > w.busy_ns ? (span1 - span0) - w.busy_ns : 0)
+              << ",\"lock_wait_ms\":" << ms(w.lock_wait_ns)
+              << ",\"start_delay_us\":" << static_cast<double>(w.first_ns - span0) / 1e3;
+            if (mode_ == StatsMode::Perf && perf_error_.empty())
+                o << ",\"cycles\":" << w.cycles << ",\"instructions\":" << w.instructions
+                  << ",\"cache_misses\":" << w.cache_misses;
+            o << '}';
+            first = false;
+        }
+        o << "]}";
+        return o.str();
+    }
+
+private:
+    StatsMode mode_ = StatsMode::Off;
+    std::chrono::steady_clock::time_point t0_{};
+    std::mutex m_;
+    std::vector<std::unique_ptr<WorkerStats>> slots_;
+    std::string perf_error_;
+};
+
+// cycles, instructions and cache misses of the calling thread as one group,
+// user space only so the default perf_event_paranoid setting allows it.
+#ifdef __linux__
+inline bool open_perf_group(int (&fds)[3]) {
+    const std::uint64_t events[3] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                     PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < 3; ++i) {
+        perf_event_attr a{};
+        a.size = sizeof(a);
+        a.type = PERF_TYPE_HARDWARE;
+        a.config = events[i];
+        a.disabled = i == 0;
+        a.exclude_kernel = 1;
+        a.exclude_hv = 1;
+        a.read_format = PERF_FORMAT_GROUP;
+        fds[i] = static_cast<int>(::syscall(SYS_perf_event_open, &a, 0, -1, i == 0 ? -1 : fds[0], 0));
+        if (fds[i] < 0) {
+            RunStats::get().perf_failed(errno);
+            for (int j = 0; j < i; ++j) { ::close(fds[j]); fds[j] = -1; }
+            return false;
+        }
+    }
+    ::ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ::ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+// adds the group's counts to s and closes it
+inline void close_perf_group(WorkerStats* s) {
+    struct { std::uint64_t nr; std::uint64_t v[3]; } r{};
+    if (::read(s->perf_fd[0], &r, sizeof(r)) == static_cast<ssize_t>(sizeof(r)) && r.nr == 3) {
+        s->cycles += r.v[0];
+        s->instructions += r.v[1];
+        s->cache_misses += r.v[2];
+    }
+    for (int& fd : s->perf_fd) { ::close(fd); fd = -1; }
+}
+#else
+inline bool open_perf_group(int (&)[3]) {
+    RunStats::get().perf_failed("not supported on this platform");
+    return false;
+}
+
+inline void close_perf_group(WorkerStats*) {}
+#endif
+
+// Binds the calling thread to slot idx until stats_detach(); no-op when off.
+inline void stats_attach(unsigned idx) {
+    RunStats& rs = RunStats::get();
+    if (!rs.enabled()) return;
+    WorkerStats* s = rs.slot(idx);
+    std::uint64_t t = rs.now_ns();
+    if (!s->used) s->first_ns = t;
+    s->used = true;
+    if (rs.mode() == StatsMode::Perf && s->perf_fd[0] < 0) open_perf_group(s->perf_fd);
+    tls_worker_stats = s;
+}
+
+inline void stats_detach() {
+    WorkerStats* s = tls_worker_stats;
+    if (!s) return;
+    s->last_ns = RunStats::get().now_ns();
+    if (s->perf_fd[0] >= 0) close_perf_group(s);
+    tls_worker_stats = nullptr;
+}
+
+struct StatsScope {
+    explicit StatsScope(unsigned idx) { stats_attach(idx); }
+    ~StatsScope() { stats_detach(); }
+    StatsScope(const StatsScope&) = delete;
+    StatsScope& operator=(const StatsScope&) = delete;
+};
+
+// Adds the scope's duration to one counter of the calling thread's slot.
+class StatsTimer {
+public:
+    explicit StatsTimer(std::uint64_t WorkerStats::*field) : s_(current_stats()), field_(field) {
+        if (s_) t0_ = RunStats::get().now_ns();
+    }
+    ~StatsTimer() {
+        if (s_) s_->*field_ += RunStats::get().now_ns() - t0_;
+    }
+    StatsTimer(const StatsTimer&) = delete;
+    StatsTimer& operator=(const StatsTimer&) = delete;
+
+private:
+    WorkerStats* s_;
+    std::uint64_t WorkerStats::*field_;
+    std::uint64_t t0_ = 0;
+};
+
+// Locks m, charging the time spent blocked to lock_wait_ns. Uncontended
+// locks (and all locks with stats off) never read the clock.
+template <class Mutex>
+inline std::unique_lock<Mutex> timed_lock(Mutex& m) {
+    std::unique_lock<Mutex> lk(m, std::try_to_lock);
+    if (!lk) {
+        StatsTimer wait(&WorkerStats::lock_wait_ns);
+        lk.lock();
+    }
+    return lk;
+}
+
+inline void stats_count(std::uint64_t candidates, std::uint64_t divisions, std::uint64_t primes) {
+    if (WorkerStats* s = current_stats()) {
+        s->candidates += candidates;
+        s->divisions += divisions;
+        s->primes += primes;
+    }
+}
+
+#endif
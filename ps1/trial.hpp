@@ -0,0 +1,236 @@
+#ifndef trial_hpp
+#define trial_hpp
+
+#include "helpers.hpp"
+#include "sieve.hpp"
+
+#include <array>
+#include <bit>
+#include <memory>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Trial division by primes only, without hardware division. For odd p,
+// inv = p^-1 mod 2^w and lim = (2^w - 1) / p give
+//     p | n   <=>   n * inv mod 2^w <= lim
+// so each candidate costs one multiply and one compare, and 4-16 of them
+// fit in one vector. Primes below 2^16 are built at compile time, with
+// 32-bit constants for n < 2^32 and 64-bit ones above. prepare_trial_table()
+// adds primes up to sqrt(limit), capped at kTrialTableCap, at runtime.
+// Beyond the table the old odd-divisor loop takes over.
+
+constexpr std::uint32_t kSmallTrialBound = kSmallPrimeBound;
+constexpr std::size_t kSmallTrialCount = kSmallPrimeCount;
+constexpr std::uint64_t kTrialTableCap = 1u << 22;
+
+constexpr std::uint64_t inverse_mod_2_64(std::uint64_t p) {
+    std::uint64_t x = p;  // correct to 3 bits for odd p; each step doubles that
+    for (int i = 0; i < 5; ++i) x *= 2 - p * x;
+    return x;
+}
+
+struct SmallTrialTable {
+    std::array<std::uint32_t, kSmallTrialCount> p{};
+    std::array<std::uint32_t, kSmallTrialCount> inv32{};
+    std::array<std::uint32_t, kSmallTrialCount> lim32{};
+    std::array<std::uint64_t, kSmallTrialCount> inv64{};
+    std::array<std::uint64_t, kSmallTrialCount> lim64{};
+};
+
+constexpr SmallTrialTable make_small_trial_table() {
+    SmallTrialTable t;
+    for (std::size_t n = 0; n < kSmallTrialCount; ++n) {
+        std::uint32_t p = kSmallPrimes[n];
+        std::uint64_t inv = inverse_mod_2_64(p);
+        t.p[n] = p;
+        t.inv32[n] = static_cast<std::uint32_t>(inv);
+        t.lim32[n] = 0xffffffffu / p;
+        t.inv64[n] = inv;
+        t.lim64[n] = ~std::uint64_t{0} / p;
+    }
+    return t;
+}
+
+inline constexpr SmallTrialTable kSmallTrial = make_small_trial_table();
+static_assert(kSmallTrial.p[kSmallTrialCount - 1] == 65521);
+
+// Odd primes in (2^16, bound], published once built and never modified.
+struct TrialExtension {
+    std::uint64_t bound = kSmallTrialBound - 1;
+    std::vector<std::uint32_t> p;
+    std::vector<std::uint64_t> inv64;
+    std::vector<std::uint64_t> lim64;
+};
+
+inline std::atomic<const TrialExtension*>& trial_extension() {
+    static std::atomic<const TrialExtension*> ext{nullptr};
+    return ext;
+}
+
+// Extends the runtime table to cover sqrt(limit) (up to kTrialTableCap).
+// Call before starting workers; tables are kept alive for the process
+// lifetime, so readers holding an older one stay valid.
+inline void prepare_trial_table(std::uint64_t limit) {
+    static std::mutex m;
+    static std::vector<std::unique_ptr<TrialExtension>> keep;
+    std::uint64_t want = std::min<std::uint64_t>(isqrt64(limit), kTrialTableCap);
+    std::lock_guard<std::mutex> lk(m);
+    const TrialExtension* cur = trial_extension().load(std::memory_order_acquire);
+    if (want < kSmallTrialBound || (cur && cur->bound >= want)) return;
+
+    auto ext = std::make_unique<TrialExtension>();
+    ext->bound = want;
+    std::vector<std::uint8_t> seg;
+    for_each_prime(kSmallTrialBound, want, sieve_base_primes(want), seg, [&](std::uint64_t p){
+        ext->p.push_back(static_cast<std::uint32_t>(p));
+        ext->inv64.push_back(inverse_mod_2_64(p));
+        ext->lim64.push_back(~std::uint64_t{0} / p);
+    });
+    trial_extension().store(ext.get(), std::memory_order_release);
+    keep.push_back(std::move(ext));
+}
+
+// Index of the first of the cnt divisors described by (inv, lim) that
+// divides n, or cnt if none does.
+inline std::size_t first_divisor32(std::uint32_t n, const std::uint32_t* inv, const std::uint32_t* lim, std::size_t cnt) {
+    std::size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512i nv = _mm512_set1_epi32(static_cast<int>(n));
+    for (; i + 16 <= cnt; i += 16) {
+        __m512i prod = _mm512_mullo_epi32(nv, _mm512_loadu_si512(inv + i));
+        if (__mmask16 m = _mm512_cmple_epu32_mask(prod, _mm512_loadu_si512(lim + i)))
+            return i + static_cast<std::size_t>(std::countr_zero(static_cast<unsigned>(m)));
+    }
+#elif defined(__AVX2__)
+    const __m256i nv = _mm256_set1_epi32(static_cast<int>(n));
+    for (; i + 8 <= cnt; i += 8) {
+        __m256i prod = _mm256_mullo_epi32(nv, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inv + i)));
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lim + i));
+        __m256i le = _mm256_cmpeq_epi32(_mm256_min_epu32(prod, l), prod);
+        if (unsigned m = static_cast<unsigned>(_mm256_movemask_epi8(le)))
+            return i + static_cast<std::size_t>(std::countr_zero(m) / 4);
+    }
+#endif
+    for (; i < cnt; ++i)
+        if (n * inv[i] <= lim[i]) return i;
+    return cnt;
+}
+
+inline std::size_t first_divisor64(std::uint64_t n, const std::uint64_t* inv, const std::uint64_t* lim, std::size_t cnt) {
+    std::size_t i = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    const __m512i nv = _mm512_set1_epi64(static_cast<long long>(n));
+    for (; i + 8 <= cnt; i += 8) {
+        __m512i prod = _mm512_mullo_epi64(nv, _mm512_loadu_si512(inv + i));
+        if (__mmask8 m = _mm512_cmple_epu64_mask(prod, _mm512_loadu_si512(lim + i)))
+            return i + static_cast<std::size_t>(std::countr_zero(static_cast<unsigned>(m)));
+    }
+#elif defined(__AVX2__)
+    // no 64-bit mullo in AVX2: lo*lo + ((hi*lo + lo*hi) << 32) from three 32x32 multiplies,
+    // and an unsigned compare by flipping the sign bit
+    const __m256i nv = _mm256_set1_epi64x(static_cast<long long>(n));
+    const __m256i n_hi = _mm256_srli_epi64(nv, 32);
+    const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(std::uint64_t{1} << 63));
+    for (; i + 4 <= cnt; i += 4) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inv + i));
+        __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(n_hi, b),
+                                         _mm256_mul_epu32(nv, _mm256_srli_epi64(b, 32)));
+        __m256i prod = _mm256_add_epi64(_mm256_mul_epu32(nv, b), _mm256_slli_epi64(cross, 32));
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lim + i));
+        __m256i gt = _mm256_cmpgt_epi64(_mm256_xor_si256(prod, sign), _mm256_xor_si256(l, sign));
+        if (unsigned m = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(gt))) & 0xfu)
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+    }
+#endif
+    for (; i < cnt; ++i)
+        if (n * inv[i] <= lim[i]) return i;
+    return cnt;
+}
+
+// Table view for one candidate: the odd primes p <= sqrt(n) that the table
+// holds, addressed by a flat index over the compile-time and runtime parts.
+struct TrialPlan {
+    std::uint64_t n;
+    std::uint64_t s;                  // isqrt(n)
+    std::size_t small;                // table primes below 2^16 that are <= s
+    std::size_t large;                // runtime-table primes that are <= s
+    const TrialExtension* ext;
+    std::uint64_t next_odd;           // first divisor the table does not cover
+
+    std::size_t size() const noexcept { return small + large; }
+
+    // Flat index of the first table prime in [lo, hi) that divides n, or hi.
+    std::size_t first_dividing(std::size_t lo, std::size_t hi) const {
+        if (lo < small) {
+            std::size_t e = std::min(hi, small);
+            std::size_t at = n <= 0xffffffffu
+                ? first_divisor32(static_cast<std::uint32_t>(n), kSmallTrial.inv32.data() + lo,
+                                  kSmallTrial.lim32.data() + lo, e - lo)
+                : first_divisor64(n, kSmallTrial.inv64.data() + lo, kSmallTrial.lim64.data() + lo, e - lo);
+            if (lo + at < e) return lo + at;
+            lo = e;
+        }
+        if (lo < hi)
+            return lo + first_divisor64(n, ext->inv64.data() + (lo - small), ext->lim64.data() + (lo - small), hi - lo);
+        return hi;
+    }
+};
+
+inline TrialPlan plan_trial(std::uint64_t n) {
+    TrialPlan t{n, isqrt64(n), 0, 0, nullptr, 0};
+    t.small = static_cast<std::size_t>(
+        std::upper_bound(kSmallTrial.p.begin(), kSmallTrial.p.end(), t.s) - kSmallTrial.p.begin());
+    std::uint64_t covered = kSmallTrialBound - 1;
+    if (t.s >= kSmallTrialBound) {
+        t.ext = trial_extension().load(std::memory_order_acquire);
+        if (t.ext) {
+            t.large = static_cast<std::size_t>(
+                std::upper_bound(t.ext->p.begin(), t.ext->p.end(), t.s) - t.ext->p.begin());
+            covered = t.ext->bound;
+        }
+    }
+    t.next_odd = (covered + 1) | 1;
+    return t;
+}
+
+// Drop-in replacement for is_prime_single; checks counts the divisors tried.
+// Every divisor a 32-bit n needs is in the compile-time table, so that
+// instantiation is one pass of first_divisor32 with no runtime table and no
+// fallback loop.
+template <class U>
+inline bool is_prime_trial_as(U n, std::uint64_t& checks) {
+    if (n < 2) return false;
+    if ((n % 2) == 0) return n == 2;
+    if constexpr (sizeof(U) == 4) {
+        std::uint32_t s = static_cast<std::uint32_t>(isqrt64(n));
+        std::size_t cnt = static_cast<std::size_t>(
+            std::upper_bound(kSmallTrial.p.begin(), kSmallTrial.p.end(), s) - kSmallTrial.p.begin());
+        std::size_t at = first_divisor32(n, kSmallTrial.inv32.data(), kSmallTrial.lim32.data(), cnt);
+        checks += at + (at < cnt);
+        return at == cnt;
+    } else {
+        TrialPlan t = plan_trial(n);
+        std::size_t at = t.first_dividing(0, t.size());
+        checks += at + (at < t.size());
+        if (at < t.size()) return false;
+        for (std::uint64_t d = t.next_odd; d <= t.s; d += 2) {
+            ++checks;
+            if ((n % d) == 0) return false;
+        }
+        return true;
+    }
+}
+
+inline bool is_prime_trial(std::uint64_t n, std::uint64_t& checks) {
+    return n <= 0xffffffffu ? is_prime_trial_as<std::uint32_t>(static_cast<std::uint32_t>(n), checks)
+                            : is_prime_trial_as<std::uint64_t>(n, checks);
+}
+
+inline bool is_prime_trial(std::uint64_t n) {
+    std::uint64_t checks = 0;
+    return is_prime_trial(n, checks);
+}
+
+#endif
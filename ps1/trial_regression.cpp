@@ -0,0 +1,60 @@
+#include "kernels.hpp"
+#include "trial.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+// Checks is_prime_trial against the sieve with and without the runtime table
+// extension, across the 32/64-bit split, and the cooperative kernel's table
+// sharing. Build once plain and once with -march=native to cover the scalar
+// and SIMD paths.
+namespace {
+
+void check_against_sieve(std::uint64_t lo, std::uint64_t hi) {
+    std::vector<std::uint8_t> seg;
+    std::uint64_t expect = lo;
+    for_each_prime(lo, hi, sieve_base_primes(hi), seg, [&](std::uint64_t p){
+        for (; expect < p; ++expect) assert(!is_prime_trial(expect));
+        assert(is_prime_trial(p));
+        expect = p + 1;
+    });
+    for (; expect <= hi; ++expect) assert(!is_prime_trial(expect));
+}
+
+}
+int main() {
+    for (std::size_t i = 0; i < kSmallTrialCount; ++i) {
+        std::uint64_t p = kSmallTrial.p[i];
+        assert(static_cast<std::uint32_t>(p * kSmallTrial.inv32[i]) == 1);
+        assert(p * kSmallTrial.inv64[i] == 1);
+    }
+
+    check_against_sieve(0, 1'000'000);
+    check_against_sieve(4'294'967'296ull - 50'000, 4'294'967'296ull + 50'000);
+    // beyond the compile-time table: odd-divisor tail, then the runtime table
+    check_against_sieve(1'000'000'000'000ull, 1'000'000'000'000ull + 2'000);
+    prepare_trial_table(1'000'000'000'000ull + 2'000);
+    check_against_sieve(1'000'000'000'000ull, 1'000'000'000'000ull + 2'000);
+
+    // squares of primes on both sides of 2^16 and at the table cap
+    assert(!is_prime_trial(65'521ull * 65'521ull));
+    assert(!is_prime_trial(65'537ull * 65'537ull));
+    assert(!is_prime_trial(999'983ull * 999'983ull));
+    assert(!is_prime_trial(4'194'301ull * 4'194'319ull));
+    assert(is_prime_trial(4'294'967'291ull));
+
+    Config cfg;
+    cfg.threads = 3;
+    cfg.coop_cutoff = 0;
+    for (std::uint64_t start : {2ull, 1'000'000'000'000ull}) {
+        cfg.start = start;
+        cfg.limit = start + 3'000;
+        std::vector<std::uint64_t> got;
+        std::mutex m;
+        run_cooperative(cfg, [&](std::uint64_t p, unsigned){ std::lock_guard<std::mutex> lk(m); got.push_back(p); });
+        std::vector<std::uint64_t> want;
+        for (std::uint64_t n = cfg.start; n <= cfg.limit; ++n) if (is_prime_single(n)) want.push_back(n);
+        assert(got == want);
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+#include "count.hpp"
+#include "kernels.hpp"
+#include "primefile.hpp"
+
+int main() {
+    const auto cfg = load_config();
+    if (cfg.mode == RunMode::Count) return run_count_mode("Variant 5", cfg);
+    print_line("[RUN START] " + now_timestamp());
+    auto t0 = std::chrono::steady_clock::now();
+
+    PrimeSet primes = collect_primes(Kernel::Sieve, cfg);
+
+    PrimeSink sink(cfg);
+    primes.for_each([&](std::uint64_t p){ sink.push(p); });
+    bool written = sink.close();
+    auto t1 = std::chrono::steady_clock::now();
+    print_line("[RUN END] " + now_timestamp());
+    print_summary("Variant 5", cfg, t1 - t0, primes.count());
+    return written ? 0 : 1;
+}
@@ -1,20 +1,31 @@
 #include <algorithm>
 #include <chrono>
+#include <atomic>
 #include <condition_variable>
 #include <cstdint>
 #include <deque>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <mutex>
-#include <numeric>
 #include <optional>
+#include <queue>
 #include <random>
+#include <semaphore>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <thread>
 #include <vector>
 #include <charconv>
 
+#include "matchmaker.hpp"
+#include "metrics.hpp"
+#include "mpmc_queue.hpp"
+#include "policy.hpp"
+#include "timing_wheel.hpp"
+
 using namespace std;
 
 // trim/parsing helpers 
@@ -85,44 +96,229 @@ static string now_hhmmss() {
 #endif
     char buf[16]; strftime(buf, sizeof(buf), "%H:%M:%S", &bt); return string(buf);
 }
+static string now_hhmmss_ms() {
+    auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count() % 1000;
+    char buf[8]; snprintf(buf, sizeof(buf), ".%03d", static_cast<int>(ms)); return now_hhmmss() + buf;
+}
+
+struct InstanceView {
+    bool active = false;
+    int job_secs = 0;
+    size_t served = 0;
+    uint64_t total_secs = 0;
+};
+
+// per-instance state, one cache line per instance so that neighbouring
+// instances never share a line. The fields are published under a seqlock:
+// the dispatcher (on assignment) and the instance's completion are the only
+// writers and never overlap, and readers such as the status logger copy a
+// consistent view without blocking them.
+struct alignas(64) Instance {
+    atomic<uint32_t> seq{0};             // odd while a write is in progress
+    atomic<bool> active{false};          // instance running
+    atomic<int> job_secs{0};             // assigned duration
+    atomic<size_t> served{0};            // parties served
+    atomic<uint64_t> total_secs{0};      // total time served
+    binary_semaphore wake{0};            // dispatch -> this instance's thread
+    atomic<uint64_t> dispatched_us{0};   // metrics: last dispatch, last start, busy time
+    atomic<uint64_t> started_us{0};
+    atomic<uint64_t> busy_us{0};
 
-// shared state (guarded by m unless stated)
+    template <class Write>
+    void publish(Write&& write) {
+        uint32_t s = seq.load(memory_order_relaxed);
+        seq.store(s + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        write();
+        seq.store(s + 2, memory_order_release);
+    }
+
+    // consistent copy; *version (if given) changes whenever the instance does
+    InstanceView read(uint32_t* version = nullptr) const {
+        for (;;) {
+            uint32_t s1 = seq.load(memory_order_acquire);
+            if (s1 & 1) continue;
+            InstanceView v{active.load(memory_order_relaxed), job_secs.load(memory_order_relaxed),
+                           served.load(memory_order_relaxed), total_secs.load(memory_order_relaxed)};
+            atomic_thread_fence(memory_order_acquire);
+            if (seq.load(memory_order_relaxed) != s1) continue;
+            if (version) *version = s1;
+            return v;
+        }
+    }
+};
+
+// shared state: no lock on the dispatch path. Idle instances go through a
+// bounded lock-free queue; a completion bumps `events` and wakes only the
+// dispatcher (atomic wait), and a dispatch wakes only its target instance.
 struct Shared {
-    mutex m; condition_variable cv;
     mutex out_m;
 
     size_t n{};
-    vector<bool> active;         // instance running
-    vector<bool> has_job;        // assignment waiting for worker pickup
-    vector<int>  job_secs;       // assigned duration
-    vector<size_t> served;       // parties served per instance
-    vector<uint64_t> total_secs; // total time per instance
-    deque<size_t> idle;          // FIFO idle instances
+    unique_ptr<Instance[]> inst;
+    MpmcQueue<uint32_t> idle;            // FIFO idle instances
+
+    atomic<size_t> total_parties{0};     // parties formed so far (fixed, or growing with --stream)
+    atomic<bool> input_done{true};       // false while a stream may still form parties
+    size_t scheduled_parties{};          // dispatcher only
+    size_t known_parties{};              // dispatcher only: parties drawn into `queues` (sjf)
+    DispatchQueues queues{Policy::Fifo}; // dispatcher only
+    alignas(64) atomic<size_t> completed_parties{0};
+    atomic<uint64_t> events{0};          // bumped on every idle push; the dispatcher waits on it
+    atomic<bool> shutdown{false};
+
+    // status logging: writers OR in what changed and bump the version the logger waits on
+    static constexpr uint32_t kAssigned = 1, kFinished = 2;
+    bool logging{false};
+    alignas(64) atomic<uint64_t> version{0};
+    atomic<uint32_t> changes{0};
 
-    size_t total_parties{};      // fixed workload
-    size_t scheduled_parties{};
-    bool shutdown{false};
+    // metrics (--metrics, --metrics-json): timestamps in microseconds since
+    // construction, or on the simulation's virtual clock
+    bool metrics{false};
+    bool simulated{false};
+    atomic<uint64_t> sim_us{0};
+    const chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    SpscChunkQueue<uint64_t> formed_us;  // formation time of each streamed party, in order
+    LatencyHistogram queue_wait;         // party formation -> dispatch
+    LatencyHistogram dispatch_start;     // dispatch -> instance starts the party
+    RateWindow completions;              // completions per second
 
     // for final summary
     size_t in_tanks{}, in_healers{}, in_dps{};
     size_t unmatched_tanks{}, unmatched_healers{}, unmatched_dps{}, unmatched_total{};
 
-    size_t total_served_nolock() const noexcept {
-        return accumulate(served.begin(), served.end(), size_t{0});
+    explicit Shared(size_t count) : n(count), inst(make_unique<Instance[]>(count)), idle(count) {}
+
+    size_t total_served() const noexcept {
+        size_t t = 0;
+        for (size_t i = 0; i < n; ++i) t += inst[i].served.load(memory_order_relaxed);
+        return t;
     }
-    uint64_t grand_total_secs_nolock() const noexcept {
-        return accumulate(total_secs.begin(), total_secs.end(), uint64_t{0});
+    uint64_t grand_total_secs() const noexcept {
+        uint64_t t = 0;
+        for (size_t i = 0; i < n; ++i) t += inst[i].total_secs.load(memory_order_relaxed);
+        return t;
     }
 
-    void print_status_snapshot(string_view header) {
-        lock_guard<mutex> lg(out_m);
-        cout << "[" << now_hhmmss() << "] " << header << "\n";
-        if (n == 0) { cout << "No instances available.\n"; cout.flush(); return; }
-        for (size_t i = 0; i < n; ++i) {
-            bool a; { lock_guard<mutex> lk(m); a = active[i]; }
-            cout << "  Instance " << i << ": " << (a ? "active" : "empty") << "\n";
+    void note_change(uint32_t what) {
+        if (!logging) return;
+        changes.fetch_or(what);
+        version.fetch_add(1);
+        version.notify_one();
+    }
+
+    // instance id is ready for a party; wakes the dispatcher
+    void make_idle(size_t id) {
+        idle.try_push(static_cast<uint32_t>(id));  // never full: each id is queued at most once
+        events.fetch_add(1, memory_order_release);
+        events.notify_one();
+    }
+
+    uint64_t now_us() const noexcept {
+        if (simulated) return sim_us.load(memory_order_relaxed);
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count());
+    }
+
+    // busy time of instance i up to `at`, counting a party still running
+    uint64_t busy_us(size_t i, uint64_t at) const noexcept {
+        const Instance& I = inst[i];
+        uint64_t b = I.busy_us.load(memory_order_relaxed);
+        if (I.active.load(memory_order_relaxed)) {
+            const uint64_t s = I.started_us.load(memory_order_relaxed);
+            if (at > s) b += at - s;
         }
-        cout.flush();
+        return b;
+    }
+
+    // a streamed party is ready; wakes the dispatcher
+    void add_party() {
+        if (metrics) formed_us.push(now_us());
+        total_parties.fetch_add(1, memory_order_release);
+        events.fetch_add(1, memory_order_release);
+        events.notify_one();
+    }
+    void finish_input() {
+        input_done.store(true, memory_order_release);
+        events.fetch_add(1, memory_order_release);
+        events.notify_one();
+    }
+
+    // next idle instance under the dispatch policy (dispatcher thread only)
+    optional<uint32_t> next_idle() {
+        if (queues.policy() == Policy::Fifo || queues.policy() == Policy::Sjf) return idle.try_pop();
+        while (optional<uint32_t> id = idle.try_pop()) queues.add_idle(*id, inst[*id].total_secs.load(memory_order_relaxed));
+        return queues.take_idle();
+    }
+
+    // formation time of the next party to become known to the dispatcher;
+    // parties given up front (no stream) all formed at time 0
+    uint64_t next_formed_us() { return metrics ? formed_us.pop().value_or(0) : 0; }
+
+    // dispatch step shared by every mode (dispatcher thread only): hands
+    // parties to idle instances as the policy picks them; on_assign(id, secs)
+    // sees each one
+    template <class OnAssign>
+    size_t dispatch(mt19937& rng, uniform_int_distribution<int>& dist, OnAssign&& on_assign) {
+        const bool sjf = queues.policy() == Policy::Sjf;
+        size_t assigned = 0;
+        for (;;) {
+            const size_t formed = total_parties.load(memory_order_acquire);
+            if (sjf) {
+                for (; known_parties < formed; ++known_parties) queues.add_party(dist(rng), next_formed_us());
+                if (!queues.has_party()) break;
+            } else if (scheduled_parties == formed) {
+                break;
+            }
+            optional<uint32_t> id = next_idle();
+            if (!id) break;
+            Instance& I = inst[*id];
+            int secs;
+            uint64_t formed_at;
+            if (sjf) tie(secs, formed_at) = queues.take_party();
+            else { secs = dist(rng); formed_at = next_formed_us(); }
+            I.publish([&] {
+                I.job_secs.store(secs, memory_order_relaxed);
+                I.active.store(true, memory_order_relaxed);
+            });
+            if (metrics) {
+                const uint64_t now = now_us();
+                queue_wait.record(now - min(now, formed_at));
+                I.dispatched_us.store(now, memory_order_relaxed);
+            }
+            ++scheduled_parties;
+            ++assigned;
+            on_assign(*id, secs);
+        }
+        if (assigned) note_change(kAssigned);
+        return assigned;
+    }
+
+    // instance id begins the party it was dispatched
+    void started(size_t id) {
+        if (!metrics) return;
+        Instance& I = inst[id];
+        const uint64_t now = now_us(), d = I.dispatched_us.load(memory_order_relaxed);
+        dispatch_start.record(now - min(now, d));
+        I.started_us.store(now, memory_order_relaxed);
+    }
+
+    // instance id finished a party of secs seconds
+    void complete(size_t id, int secs) {
+        Instance& I = inst[id];
+        if (metrics) {
+            const uint64_t now = now_us(), s = I.started_us.load(memory_order_relaxed);
+            I.busy_us.fetch_add(now - min(now, s), memory_order_relaxed);
+            completions.add(now / 1000000);
+        }
+        I.publish([&] {
+            I.active.store(false, memory_order_relaxed);
+            I.served.fetch_add(1, memory_order_relaxed);
+            I.total_secs.fetch_add(static_cast<uint64_t>(secs), memory_order_relaxed);
+        });
+        completed_parties.fetch_add(1, memory_order_relaxed);
+        note_change(kFinished);
+        make_idle(id);
     }
 
     void print_final_summary() {
@@ -130,14 +326,11 @@ struct Shared {
         cout << "\n****** Summary ******\n";
         if (n == 0) { cout << "No instances existed.\n"; }
         for (size_t i = 0; i < n; ++i) {
-            size_t s; uint64_t secs; { lock_guard<mutex> lk(m); s = served[i]; secs = total_secs[i]; }
-            cout << "Instance " << i << " → parties served: " << s
-                 << ", total time served: " << secs << "s\n";
+            cout << "Instance " << i << " → parties served: " << inst[i].served.load(memory_order_relaxed)
+                 << ", total time served: " << inst[i].total_secs.load(memory_order_relaxed) << "s\n";
         }
-        size_t grand_parties; uint64_t grand_secs;
-        { lock_guard<mutex> lk(m); grand_parties = total_served_nolock(); grand_secs = grand_total_secs_nolock(); }
-        cout << "Total parties served: " << grand_parties << "\n";
-        cout << "Total time served: " << grand_secs << " seconds\n";
+        cout << "Total parties served: " << total_served() << "\n";
+        cout << "Total time served: " << grand_total_secs() << " seconds\n";
         cout << "Unmatched Players: " << unmatched_total << "\n";
         cout << "Unmatched Tanks: " << unmatched_tanks << "\n";
         cout << "Unmatched Healers: " << unmatched_healers << "\n";
@@ -146,40 +339,505 @@ struct Shared {
     }
 };
 
+enum class LogMode { Full, Diff };
+enum class LogFormat { Human, Compact, Json };
+
+// status output off the dispatch path: a logger thread waits on
+// Shared::version, copies the instances through their seqlocks and prints
+// either full snapshots or only the instances that changed (their seqlock
+// version moved) since the last output. Changes that arrive while it is
+// printing, or within `interval` of the last output, are coalesced.
+class StatusLogger {
+public:
+    StatusLogger(Shared& S, LogMode mode, LogFormat format, chrono::milliseconds interval)
+        : S_(S), mode_(mode), format_(format), interval_(interval), last_seq_(S.n, 0) {}
+
+    void start() {
+        S_.logging = true;
+        thread_ = jthread([this] { run(); });
+    }
+
+    // stops the thread at once, also mid-interval; changes not yet printed
+    // are left to the caller's final snapshot
+    void stop() {
+        if (!thread_.joinable()) return;
+        {
+            lock_guard<mutex> lk(stop_m_);
+            stop_.store(true);
+        }
+        stop_cv_.notify_one();
+        S_.version.fetch_add(1);
+        S_.version.notify_one();
+        thread_.join();
+    }
+
+    // full snapshot from the calling thread (while the logger thread is not running)
+    void snapshot(string_view header) { emit(header, true); }
+
+private:
+    void run() {
+        uint64_t seen = S_.version.load();
+        auto last = chrono::steady_clock::now() - interval_;
+        for (;;) {
+            S_.version.wait(seen);
+            if (interval_.count() > 0) {
+                unique_lock<mutex> lk(stop_m_);
+                stop_cv_.wait_until(lk, last + interval_, [&] { return stop_.load(); });
+            }
+            // load seen before checking stop_, so a shutdown bump between
+            // the two is never absorbed into seen
+            seen = S_.version.load();
+            if (stop_.load()) return;
+            const uint32_t what = S_.changes.exchange(0);
+            if (what) {
+                emit(what == Shared::kAssigned ? "Status change: dispatcher assigned parties"
+                   : what == Shared::kFinished ? "Status change: instance finished a party"
+                   : "Status change: dispatcher assigned parties, instance finished a party",
+                     mode_ == LogMode::Full);
+                last = chrono::steady_clock::now();
+            }
+        }
+    }
+
+    void emit(string_view header, bool full) {
+        string out;
+        size_t active = 0;
+        vector<pair<size_t, InstanceView>> shown;
+        for (size_t i = 0; i < S_.n; ++i) {
+            uint32_t v;
+            InstanceView iv = S_.inst[i].read(&v);
+            active += iv.active;
+            if (full || v != last_seq_[i]) shown.push_back({i, iv});
+            last_seq_[i] = v;
+        }
+        if (shown.empty() && !full) return;  // already covered by the previous output
+        const char* kind = full ? "full" : "diff";
+        if (format_ == LogFormat::Human) {
+            out += "[" + now_hhmmss() + "] " + string(header) + "\n";
+            if (S_.n == 0) out += "No instances available.\n";
+            for (auto& [i, iv] : shown) out += "  Instance " + to_string(i) + ": " + (iv.active ? "active" : "empty") + "\n";
+        } else if (format_ == LogFormat::Compact) {
+            out += now_hhmmss_ms() + " " + kind + " active=" + to_string(active) + "/" + to_string(S_.n) + " ";
+            if (full) for (auto& e : shown) out += e.second.active ? 'A' : '.';
+            else for (auto& [i, iv] : shown) out += to_string(i) + (iv.active ? ":A " : ":. ");
+            out += "\n";
+        } else {
+            out += "{\"time\":\"" + now_hhmmss_ms() + "\",\"kind\":\"" + kind + "\",\"event\":\"" + string(header)
+                 + "\",\"active\":" + to_string(active) + ",\"n\":" + to_string(S_.n) + ",\"instances\":[";
+            for (size_t k = 0; k < shown.size(); ++k) {
+                auto& [i, iv] = shown[k];
+                out += (k ? ",{\"id\":" : "{\"id\":") + to_string(i) + ",\"active\":" + (iv.active ? "true" : "false")
+                     + ",\"job_secs\":" + to_string(iv.job_secs) + ",\"served\":" + to_string(iv.served)
+                     + ",\"total_secs\":" + to_string(iv.total_secs) + "}";
+            }
+            out += "]}\n";
+        }
+        lock_guard<mutex> lg(S_.out_m);
+        cout << out;
+        cout.flush();
+    }
+
+    Shared& S_;
+    LogMode mode_;
+    LogFormat format_;
+    chrono::milliseconds interval_;
+    vector<uint32_t> last_seq_;          // logger thread (or the caller of snapshot) only
+    atomic<bool> stop_{false};
+    mutex stop_m_;                       // stop_cv_ cuts the interval wait short
+    condition_variable stop_cv_;
+    jthread thread_;
+};
+
 // worker thread
 static void instance_worker(size_t id, Shared& S) {
-    unique_lock<mutex> lk(S.m);
-    S.idle.push_back(id);
-    S.cv.notify_one();
+    Instance& I = S.inst[id];
+    S.make_idle(id);
 
     for (;;) {
-        S.cv.wait(lk, [&]{ return S.has_job[id] || S.shutdown; });
-        if (S.shutdown && !S.has_job[id]) break;
-
-        const int secs = S.job_secs[id];
-        S.has_job[id] = false;
-        lk.unlock();
+        I.wake.acquire();
+        if (S.shutdown.load(memory_order_acquire)) break;
+        S.started(id);
 
+        const int secs = I.job_secs.load(memory_order_relaxed);
         this_thread::sleep_for(chrono::seconds(secs));
 
-        lk.lock();
-        S.active[id] = false;
-        S.served[id] += 1;
-        S.total_secs[id] += static_cast<uint64_t>(secs);
-        S.idle.push_back(id);
-        lk.unlock();
-        S.cv.notify_all();
+        S.complete(id, secs);
+    }
+}
+
+// dispatcher (main thread): assigns parties as instances go idle, then waits
+// for the last completion and shuts down; on_assign(id, secs) runs on this thread
+template <class OnAssign>
+static void run_dispatcher(Shared& S, mt19937& rng, uniform_int_distribution<int>& dist, OnAssign&& on_assign) {
+    for (;;) {
+        uint64_t seen = S.events.load(memory_order_acquire);
+        bool last = S.input_done.load(memory_order_acquire);
+        if (last && S.scheduled_parties == S.total_parties.load(memory_order_acquire)) break;
+        if (S.dispatch(rng, dist, on_assign) == 0) S.events.wait(seen, memory_order_acquire);
+    }
+
+    // wait for completion, then shutdown 
+    for (;;) {
+        uint64_t seen = S.events.load(memory_order_acquire);
+        if (S.completed_parties.load(memory_order_acquire) == S.scheduled_parties) break;
+        S.events.wait(seen, memory_order_acquire);
+    }
+    S.shutdown.store(true, memory_order_release);
+}
+
+// pooled mode: instances are only their Shared records. A timer thread keeps
+// the running parties in a timing wheel (10 ms ticks) and hands each expired
+// one to a fixed pool of workers, which do the completion bookkeeping that
+// instance_worker does after its sleep. Memory per instance is a few words
+// and the thread count is independent of n.
+static void run_pooled(Shared& S, mt19937& rng, uniform_int_distribution<int>& dist, unsigned workers) {
+    using clock = chrono::steady_clock;
+    constexpr chrono::milliseconds kTick{10};
+    const auto t0 = clock::now();
+    auto tick_now = [&]{ return static_cast<uint64_t>((clock::now() - t0) / kTick); };
+
+    TimingWheel wheel(S.n);
+    mutex wm; condition_variable wcv;      // wheel
+    mutex qm; condition_variable qcv;      // expired instances for the pool
+    deque<uint32_t> ready;
+    bool stop = false;                     // under wm for the timer, qm for the pool
+
+    for (size_t i = 0; i < S.n; ++i) S.make_idle(i);
 
-        S.print_status_snapshot("Status change: instance finished a party");
+    jthread timer([&]{
+        unique_lock<mutex> wl(wm);
+        vector<uint32_t> expired;
+        while (!stop) {
+            if (wheel.size() == 0) { wcv.wait(wl, [&]{ return stop || wheel.size() != 0; }); continue; }
+            auto next = t0 + kTick * static_cast<int64_t>(wheel.now() + 1);
+            wl.unlock();
+            this_thread::sleep_until(next);
+            wl.lock();
+            wheel.advance(tick_now(), [&](uint32_t id){ expired.push_back(id); });
+            if (expired.empty()) continue;
+            {
+                lock_guard<mutex> ql(qm);
+                ready.insert(ready.end(), expired.begin(), expired.end());
+            }
+            expired.size() == 1 ? qcv.notify_one() : qcv.notify_all();
+            expired.clear();
+        }
+    });
+
+    vector<jthread> pool;
+    for (unsigned w = 0; w < workers; ++w) pool.emplace_back([&]{
+        for (;;) {
+            uint32_t id;
+            {
+                unique_lock<mutex> ql(qm);
+                qcv.wait(ql, [&]{ return stop || !ready.empty(); });
+                if (ready.empty()) return;
+                id = ready.front(); ready.pop_front();
+            }
+            S.complete(id, S.inst[id].job_secs.load(memory_order_relaxed));
+        }
+    });
+
+    run_dispatcher(S, rng, dist, [&](size_t id, int secs) {
+        lock_guard<mutex> wl(wm);
+        bool was_empty = wheel.size() == 0;
+        wheel.schedule(static_cast<uint32_t>(id), tick_now() + static_cast<uint64_t>(secs) * (1000 / kTick.count()));
+        if (was_empty) wcv.notify_one();
+        S.started(id);
+    });
+
+    { lock_guard<mutex> wl(wm); lock_guard<mutex> ql(qm); stop = true; }
+    wcv.notify_all();
+    qcv.notify_all();
+}
+
+// --stream input: join/leave events from a file or stdin, matched into
+// parties that go to the dispatcher as soon as they form
+struct StreamFeed {
+    EventReader reader;
+    Matchmaker mm;
+    optional<StreamEvent> pending;
+    uint64_t clock_ms = 0;               // time of the last applied event
+    uint64_t applied = 0;
+
+    explicit StreamFeed(istream& in) : reader(in) {}
+
+    // next event, not yet applied; nullptr at the end of the stream
+    const StreamEvent* peek() {
+        if (!pending) { StreamEvent e; if (reader.next(e)) pending = e; }
+        return pending ? &*pending : nullptr;
+    }
+    void apply(Shared& S) {
+        StreamEvent e = *pending; pending.reset();
+        clock_ms = max(clock_ms, e.at_ms);
+        ++applied;
+        if (e.join) mm.join(e.player, e.role, clock_ms, [&](uint64_t) { S.add_party(); });
+        else mm.leave(e.player);
+    }
+};
+
+// with --stream, t/h/d are the queue at time 0: anonymous joins with ids no stream player uses
+static void queue_initial_players(StreamFeed& F, Shared& S, size_t tanks, size_t healers, size_t dps) {
+    S.total_parties = 0;
+    S.input_done = false;
+    uint64_t anon = uint64_t{1} << 63;
+    for (auto [count, role] : {pair{tanks, Role::Tank}, pair{healers, Role::Healer}, pair{dps, Role::Dps}})
+        for (size_t i = 0; i < count; ++i) F.mm.join(anon++, role, 0, [&](uint64_t) { S.add_party(); });
+}
+
+// real-time modes: replays the stream at its own timestamps from t0
+static void run_stream_feeder(StreamFeed& F, Shared& S, chrono::steady_clock::time_point t0) {
+    while (const StreamEvent* e = F.peek()) {
+        if (e->at_ms > F.clock_ms) this_thread::sleep_until(t0 + chrono::milliseconds(e->at_ms));
+        F.apply(S);
+    }
+    S.finish_input();
+}
 
-        lk.lock();
+// discrete-event mode: the same Shared bookkeeping and dispatch step, but
+// completions come off a min-heap keyed by virtual finish time instead of
+// from sleeping threads, merged with the stream's events when there is one.
+// Completions due at the same instant are all applied (in dispatch order)
+// before the next dispatch round, and before stream events at that instant.
+// Returns the makespan (last completion) in milliseconds.
+static uint64_t run_simulation(Shared& S, mt19937& rng, uniform_int_distribution<int>& dist, StreamFeed* feed) {
+    struct Event { uint64_t at; uint64_t seq; size_t id; int secs; };
+    auto later = [](const Event& a, const Event& b) { return a.at != b.at ? a.at > b.at : a.seq > b.seq; };
+    priority_queue<Event, vector<Event>, decltype(later)> events(later);
+
+    uint64_t now = 0, seq = 0, makespan = 0;
+    for (size_t i = 0; i < S.n; ++i) S.make_idle(i);
+    for (;;) {
+        S.sim_us.store(now * 1000, memory_order_relaxed);
+        S.dispatch(rng, dist, [&](size_t id, int secs) {
+            events.push({now + static_cast<uint64_t>(secs) * 1000, seq++, id, secs});
+            S.started(id);
+        });
+        const StreamEvent* next = feed ? feed->peek() : nullptr;
+        if (events.empty() && !next) break;
+        if (next && (events.empty() || max(now, next->at_ms) < events.top().at)) {
+            now = max(now, next->at_ms);
+            S.sim_us.store(now * 1000, memory_order_relaxed);
+            feed->apply(S);
+            continue;
+        }
+        now = makespan = events.top().at;
+        S.sim_us.store(now * 1000, memory_order_relaxed);
+        while (!events.empty() && events.top().at == now) {
+            Event e = events.top(); events.pop();
+            S.complete(e.id, e.secs);
+        }
+    }
+    if (feed) S.finish_input();
+    return makespan;
+}
+
+static void print_stream_summary(const StreamFeed& F) {
+    cout << "Queue wait (join to party formation):\n";
+    for (Role r : {Role::Tank, Role::Healer, Role::Dps}) {
+        const RoleWait& w = F.mm.wait(r);
+        cout << "  " << kRoleNames[static_cast<int>(r)] << ": matched " << w.matched
+             << ", avg " << fixed << setprecision(3) << (w.matched ? w.total_ms / 1000.0 / w.matched : 0.0)
+             << "s, max " << w.max_ms / 1000.0 << "s, still queued " << F.mm.waiting(r) << "\n";
     }
+    cout << defaultfloat << "Stream: " << F.applied << " events, " << F.mm.joins() << " joins, "
+         << F.mm.leaves() << " leaves, " << F.mm.parties() << " parties formed";
+    if (F.mm.duplicate_joins()) cout << ", " << F.mm.duplicate_joins() << " duplicate joins ignored";
+    cout << "\n";
+}
+
+// metrics export: a Prometheus text-format file, rewritten periodically
+// while the run lasts (write to FILE.tmp, then rename), and a JSON summary at
+// exit. Both only read the relaxed counters, so exporting never stalls the
+// dispatcher or an instance.
+static constexpr size_t kInstanceSeriesMax = 1000;  // per-instance Prometheus series up to this n
+static constexpr unsigned kRateWindows[] = {1, 10, 60};
+
+// completions per second over the last `window` whole seconds before `at`
+// (over the partial first second while less than one has passed)
+static double parties_per_sec(const Shared& S, uint64_t at, unsigned window) {
+    const uint64_t full = at / 1000000;
+    if (full == 0) return at ? static_cast<double>(S.completions.count(0, 1)) / (at / 1e6) : 0.0;
+    const unsigned w = static_cast<unsigned>(min<uint64_t>(window, full));
+    return static_cast<double>(S.completions.count(full - 1, w)) / w;
+}
+
+static double utilization(const Shared& S, uint64_t at) {
+    if (S.n == 0 || at == 0) return 0.0;
+    uint64_t busy = 0;
+    for (size_t i = 0; i < S.n; ++i) busy += S.busy_us(i, at);
+    return static_cast<double>(busy) / (static_cast<double>(at) * static_cast<double>(S.n));
+}
+
+static void write_prom_histogram(ostream& o, string_view name, string_view help, const LatencyHistogram& h) {
+    static constexpr double kBounds[] = {0.001, 0.005, 0.01, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300};
+    o << "# HELP " << name << ' ' << help << "\n# TYPE " << name << " histogram\n";
+    for (double b : kBounds) o << name << "_bucket{le=\"" << b << "\"} " << h.count_le(static_cast<uint64_t>(b * 1e6)) << "\n";
+    const uint64_t count = h.count();
+    o << name << "_bucket{le=\"+Inf\"} " << count << "\n"
+      << name << "_sum " << h.sum() / 1e6 << "\n"
+      << name << "_count " << count << "\n";
+}
+
+static void write_prometheus(const Shared& S, const string& path) {
+    const uint64_t at = S.now_us();
+    ostringstream o;
+    o << "# HELP lfg_parties_formed_total Parties formed so far.\n# TYPE lfg_parties_formed_total counter\n"
+      << "lfg_parties_formed_total " << S.total_parties.load(memory_order_relaxed) << "\n"
+      << "# HELP lfg_parties_completed_total Parties that finished their dungeon.\n# TYPE lfg_parties_completed_total counter\n"
+      << "lfg_parties_completed_total " << S.completed_parties.load(memory_order_relaxed) << "\n";
+    size_t active = 0;
+    for (size_t i = 0; i < S.n; ++i) active += S.inst[i].active.load(memory_order_relaxed);
+    o << "# HELP lfg_instances_active Instances running a party.\n# TYPE lfg_instances_active gauge\n"
+      << "lfg_instances_active " << active << "\n"
+      << "# HELP lfg_instances Instances in the run.\n# TYPE lfg_instances gauge\n"
+      << "lfg_instances " << S.n << "\n"
+      << "# HELP lfg_utilization_ratio Busy time over elapsed time, all instances.\n# TYPE lfg_utilization_ratio gauge\n"
+      << "lfg_utilization_ratio " << utilization(S, at) << "\n"
+      << "# HELP lfg_parties_per_second Completions per second over a sliding window.\n# TYPE lfg_parties_per_second gauge\n";
+    for (unsigned w : kRateWindows) o << "lfg_parties_per_second{window=\"" << w << "s\"} " << parties_per_sec(S, at, w) << "\n";
+    write_prom_histogram(o, "lfg_queue_wait_seconds", "Time from party formation to dispatch.", S.queue_wait);
+    write_prom_histogram(o, "lfg_dispatch_start_seconds", "Time from dispatch to the instance starting the party.", S.dispatch_start);
+    if (S.n <= kInstanceSeriesMax) {
+        o << "# HELP lfg_instance_utilization_ratio Busy time over elapsed time, per instance.\n# TYPE lfg_instance_utilization_ratio gauge\n";
+        for (size_t i = 0; i < S.n; ++i)
+            o << "lfg_instance_utilization_ratio{instance=\"" << i << "\"} " << (at ? static_cast<double>(S.busy_us(i, at)) / static_cast<double>(at) : 0.0) << "\n";
+        o << "# HELP lfg_instance_parties_total Parties served, per instance.\n# TYPE lfg_instance_parties_total counter\n";
+        for (size_t i = 0; i < S.n; ++i)
+            o << "lfg_instance_parties_total{instance=\"" << i << "\"} " << S.inst[i].served.load(memory_order_relaxed) << "\n";
+    }
+    const string tmp = path + ".tmp";
+    if (!(ofstream(tmp, ios::trunc) << o.str()) || rename(tmp.c_str(), path.c_str()) != 0)
+        cerr << "Warning: could not write metrics to " << path << "\n";
+}
+
+static void write_latency_json(ostream& o, const LatencyHistogram& h) {
+    o << "{\"count\": " << h.count() << ", \"mean\": " << h.mean() / 1e3;
+    for (auto [name, q] : {pair{"p50", 0.5}, pair{"p90", 0.9}, pair{"p99", 0.99}, pair{"p999", 0.999}})
+        o << ", \"" << name << "\": " << static_cast<double>(h.percentile(q)) / 1e3;
+    o << ", \"max\": " << static_cast<double>(h.max()) / 1e3 << "}";
 }
 
-int main() {
+static void write_metrics_json(const Shared& S, ostream& o) {
+    const uint64_t at = S.now_us();
+    const uint64_t done = S.completed_parties.load(memory_order_relaxed);
+    o << defaultfloat << setprecision(6) << "{\n  \"elapsed_s\": " << at / 1e6 << ",\n  \"instances\": " << S.n
+      << ",\n  \"parties_formed\": " << S.total_parties.load(memory_order_relaxed)
+      << ",\n  \"parties_completed\": " << done
+      << ",\n  \"utilization\": " << utilization(S, at)
+      << ",\n  \"parties_per_second\": {";
+    for (unsigned w : kRateWindows) o << "\"" << w << "s\": " << parties_per_sec(S, at, w) << ", ";
+    o << "\"overall\": " << (at ? static_cast<double>(done) / (at / 1e6) : 0.0) << "}"
+      << ",\n  \"queue_wait_ms\": ";
+    write_latency_json(o, S.queue_wait);
+    o << ",\n  \"dispatch_start_ms\": ";
+    write_latency_json(o, S.dispatch_start);
+    o << ",\n  \"per_instance\": [";
+    for (size_t i = 0; i < S.n; ++i) {
+        const uint64_t busy = S.busy_us(i, at);
+        o << (i ? ",\n    " : "\n    ") << "{\"id\": " << i << ", \"served\": " << S.inst[i].served.load(memory_order_relaxed)
+          << ", \"busy_s\": " << busy / 1e6 << ", \"utilization\": " << (at ? static_cast<double>(busy) / static_cast<double>(at) : 0.0) << "}";
+    }
+    o << (S.n ? "\n  ]\n}\n" : "]\n}\n");
+}
+
+static string format_ms(uint64_t ms) {
+    string s = to_string(ms / 1000);
+    if (ms % 1000) { char frac[8]; snprintf(frac, sizeof(frac), ".%03u", static_cast<unsigned>(ms % 1000)); s += frac; }
+    return s;
+}
+
+// --compare: the same workload (same seed, same stream) simulated under
+// every policy, with makespan, queue-wait distribution, utilization and the
+// spread of parties per instance side by side
+static void print_policy_comparison(size_t n, size_t parties, size_t tanks, size_t healers, size_t dps,
+                                    int t1, int t2, uint64_t seed, const optional<string>& stream_path) {
+    auto secs = [](uint64_t us) { ostringstream o; o << ' ' << fixed << setprecision(3) << us / 1e6 << "s"; return o.str(); };
+    cout << "Policy comparison (simulated, seed " << seed << "):\n"
+         << "  " << left << setw(13) << "policy" << right << setw(13) << "makespan" << setw(13) << "wait mean"
+         << setw(12) << "p50" << setw(12) << "p90" << setw(12) << "p99" << setw(12) << "max"
+         << setw(8) << "util" << "  served min/max\n";
+    for (int p = 0; p < 4; ++p) {
+        Shared S(n);
+        S.metrics = S.simulated = true;
+        S.total_parties = parties;
+        S.queues = DispatchQueues(static_cast<Policy>(p));
+        ifstream file;
+        unique_ptr<StreamFeed> feed;
+        if (stream_path) {
+            file.open(*stream_path, ios::binary);
+            feed = make_unique<StreamFeed>(file);
+            queue_initial_players(*feed, S, tanks, healers, dps);
+        }
+        mt19937 rng(static_cast<mt19937::result_type>(seed));
+        uniform_int_distribution<int> dist(t1, t2);
+        const uint64_t makespan = run_simulation(S, rng, dist, feed.get());
+
+        size_t lo = SIZE_MAX, hi = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const size_t served = S.inst[i].served.load(memory_order_relaxed);
+            lo = min(lo, served); hi = max(hi, served);
+        }
+        const LatencyHistogram& w = S.queue_wait;
+        cout << "  " << left << setw(13) << kPolicyNames[p] << right << setw(13) << format_ms(makespan) + "s"
+             << setw(13) << secs(static_cast<uint64_t>(w.mean())) << setw(12) << secs(w.percentile(0.5))
+             << setw(12) << secs(w.percentile(0.9)) << setw(12) << secs(w.percentile(0.99)) << setw(12) << secs(w.max())
+             << setw(7) << fixed << setprecision(1) << utilization(S, S.now_us()) * 100 << "%  " << lo << "/" << hi << "\n";
+    }
+    cout << defaultfloat;
+}
+
+int main(int argc, char** argv) {
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
 
+    // command line: --simulate (virtual clock, no sleeping), --pool[=W] (W workers
+    // and a timing wheel instead of one thread per instance), --seed=N (fixed
+    // RNG seed), --quiet (no status snapshots), --stream=FILE|- (join/leave
+    // events; - reads them from stdin after the six values), --log=full|diff,
+    // --log-format=human|compact|json, --log-interval=MS (status logger),
+    // --metrics=FILE and --metrics-interval=MS (Prometheus text file),
+    // --metrics-json=FILE|- (JSON summary at exit), --policy=fifo|least-busy|
+    // round-robin|sjf (dispatch policy), --compare (simulate every policy)
+    bool simulate = false, quiet = false, compare = false;
+    Policy policy = Policy::Fifo;
+    LogMode log_mode = LogMode::Full;
+    LogFormat log_format = LogFormat::Human;
+    chrono::milliseconds log_interval{0};
+    optional<string> metrics_path, metrics_json;
+    chrono::milliseconds metrics_interval{1000};
+    optional<unsigned> pool;
+    optional<string> stream_path;
+    optional<uint64_t> seed;
+    for (int i = 1; i < argc; ++i) {
+        string_view a = argv[i];
+        uint64_t v{};
+        if (a == "--simulate") simulate = true;
+        else if (a == "--quiet") quiet = true;
+        else if (a == "--pool") pool = max(1u, thread::hardware_concurrency());
+        else if (a.starts_with("--pool=") && parse_integral_sv(a.substr(7), v) && v >= 1 && v <= 1024) pool = static_cast<unsigned>(v);
+        else if (a.starts_with("--seed=") && parse_integral_sv(a.substr(7), v)) seed = v;
+        else if (a.starts_with("--stream=") && a.size() > 9) stream_path = string(a.substr(9));
+        else if (a == "--log=full") log_mode = LogMode::Full;
+        else if (a == "--log=diff") log_mode = LogMode::Diff;
+        else if (a == "--log-format=human") log_format = LogFormat::Human;
+        else if (a == "--log-format=compact") log_format = LogFormat::Compact;
+        else if (a == "--log-format=json") log_format = LogFormat::Json;
+        else if (a.starts_with("--log-interval=") && parse_integral_sv(a.substr(15), v) && v <= 3600000) log_interval = chrono::milliseconds(v);
+        else if (a.starts_with("--metrics=") && a.size() > 10) metrics_path = string(a.substr(10));
+        else if (a.starts_with("--metrics-interval=") && parse_integral_sv(a.substr(19), v) && v >= 10 && v <= 3600000) metrics_interval = chrono::milliseconds(v);
+        else if (a.starts_with("--metrics-json=") && a.size() > 15) metrics_json = string(a.substr(15));
+        else if (a.starts_with("--policy=") && parse_policy(a.substr(9), policy)) {}
+        else if (a == "--compare") compare = true;
+        else {
+            cerr << "Unknown option '" << a << "'. Usage: main [--simulate | --pool[=W]] [--seed=N] [--quiet] [--stream=FILE|-]\n"
+                 << "    [--log=full|diff] [--log-format=human|compact|json] [--log-interval=MS]\n"
+                 << "    [--metrics=FILE] [--metrics-interval=MS] [--metrics-json=FILE|-]\n"
+                 << "    [--policy=fifo|least-busy|round-robin|sjf] [--compare]\n";
+            return 1;
+        }
+    }
+
     // inputs with prompts + validation
     long long n_ll=0, t_ll=0, h_ll=0, d_ll=0, t1_ll=0, t2_ll=0;
 
@@ -215,6 +873,12 @@ int main() {
     const size_t unmatched_dps    = dps    - 3 * parties;
     const size_t unmatched_total  = unmatched_tanks + unmatched_healers + unmatched_dps;
 
+    if (compare && stream_path && *stream_path == "-") { cerr << "\nError: --compare replays the stream once per policy and needs --stream=FILE.\n"; return 1; }
+    if (stream_path) {
+        if (n == 0) { cerr << "\nError: --stream needs at least one instance (n >= 1).\n"; return 1; }
+        if (*stream_path != "-" && !ifstream(*stream_path)) { cerr << "\nError: cannot open " << *stream_path << ".\n"; return 1; }
+    }
+
     // deadlock guard: handle n == 0 
     if (n == 0) {
         if (parties == 0) {
@@ -237,16 +901,20 @@ int main() {
     }
 
     // shared state init
-    Shared S;
-    S.n = n;
-    S.active.assign(n, false);
-    S.has_job.assign(n, false);
-    S.job_secs.assign(n, 0);
-    S.served.assign(n, 0);
-    S.total_secs.assign(n, 0);
+    Shared S(n);
     S.total_parties = parties;
-    S.scheduled_parties = 0;
-    S.shutdown = false;
+    S.metrics = metrics_path || metrics_json;
+    S.simulated = simulate;
+    S.queues = DispatchQueues(policy);
+
+    // with --stream, t/h/d are the queue at time 0 and parties form as events arrive
+    ifstream stream_file;
+    unique_ptr<StreamFeed> feed;
+    if (stream_path) {
+        if (*stream_path != "-") stream_file.open(*stream_path, ios::binary);
+        feed = make_unique<StreamFeed>(*stream_path == "-" ? static_cast<istream&>(cin) : stream_file);
+        queue_initial_players(*feed, S, tanks, healers, dps);
+    }
     S.in_tanks = tanks; S.in_healers = healers; S.in_dps = dps;
     S.unmatched_tanks = unmatched_tanks;
     S.unmatched_healers = unmatched_healers;
@@ -259,47 +927,104 @@ int main() {
         cout << "  instances=" << n << ", tanks=" << tanks
              << ", healers=" << healers << ", dps=" << dps
              << ", t1=" << t1 << "s, t2=" << t2 << "s\n";
-        cout << "  Total parties to run: " << S.total_parties << "\n";
-        cout << "  Unmatched (cannot form full parties): Tanks=" << unmatched_tanks
-             << ", Healers=" << unmatched_healers << ", DPS=" << unmatched_dps
-             << " (Total=" << unmatched_total << ")\n\n";
+        if (policy != Policy::Fifo) cout << "  Dispatch policy: " << kPolicyNames[static_cast<int>(policy)] << "\n";
+        if (feed) {
+            cout << "  Streaming join/leave events from " << (*stream_path == "-" ? "stdin" : *stream_path)
+                 << "; the counts above are the queue at time 0\n\n";
+        } else {
+            cout << "  Total parties to run: " << S.total_parties << "\n";
+            cout << "  Unmatched (cannot form full parties): Tanks=" << unmatched_tanks
+                 << ", Healers=" << unmatched_healers << ", DPS=" << unmatched_dps
+                 << " (Total=" << unmatched_total << ")\n\n";
+        }
     }
+    // players still queued when the stream ends count as unmatched
+    auto settle_stream = [&] {
+        if (!feed) return;
+        S.unmatched_tanks = feed->mm.waiting(Role::Tank);
+        S.unmatched_healers = feed->mm.waiting(Role::Healer);
+        S.unmatched_dps = feed->mm.waiting(Role::Dps);
+        S.unmatched_total = S.unmatched_tanks + S.unmatched_healers + S.unmatched_dps;
+    };
 
-    // start workers 
-    vector<jthread> threads; threads.reserve(n);
-    for (size_t i = 0; i < n; ++i) threads.emplace_back(instance_worker, i, std::ref(S));
+    // --metrics-json: to a file, or after the summary with -
+    auto write_json = [&] {
+        if (!metrics_json) return;
+        if (*metrics_json == "-") { write_metrics_json(S, cout); return; }
+        ofstream out(*metrics_json, ios::trunc);
+        write_metrics_json(S, out);
+        if (!out) cerr << "Warning: could not write metrics to " << *metrics_json << "\n";
+    };
 
-    S.print_status_snapshot("Initial status");
+    if (compare) {
+        print_policy_comparison(n, parties, tanks, healers, dps, t1, t2, seed.value_or(random_device{}()), stream_path);
+        return 0;
+    }
 
-    // dispatcher (main thread) 
-    std::mt19937 rng(std::random_device{}());
+    std::mt19937 rng(seed ? static_cast<mt19937::result_type>(*seed) : std::random_device{}());
     std::uniform_int_distribution<int> dist(t1, t2);
 
-    while (true) {
-        unique_lock<mutex> lk(S.m);
-        if (S.scheduled_parties >= S.total_parties) break;
-        S.cv.wait(lk, [&]{ return !S.idle.empty(); });
-        while (!S.idle.empty() && S.scheduled_parties < S.total_parties) {
-            size_t id = S.idle.front(); S.idle.pop_front();
-            S.job_secs[id] = dist(rng);
-            S.has_job[id] = true;
-            S.active[id]  = true;
-            ++S.scheduled_parties;
-        }
-        lk.unlock();
-        S.cv.notify_all();
-        S.print_status_snapshot("Status change: dispatcher assigned parties");
+    if (simulate) {
+        auto w0 = chrono::steady_clock::now();
+        uint64_t makespan = run_simulation(S, rng, dist, feed.get());
+        double wall = chrono::duration<double>(chrono::steady_clock::now() - w0).count();
+        settle_stream();
+        if (metrics_path) write_prometheus(S, *metrics_path);
+        S.print_final_summary();
+        if (feed) print_stream_summary(*feed);
+        const size_t total = S.total_parties.load();
+        cout << "Simulated makespan: " << format_ms(makespan) << "s (" << total << " parties";
+        if (feed) cout << ", " << feed->applied << " events";
+        cout << " in " << fixed << setprecision(3) << wall * 1e3 << " ms, "
+             << setprecision(0) << (wall > 0 ? total / wall : 0.0) << " completions/s";
+        if (feed) cout << ", " << (wall > 0 ? feed->applied / wall : 0.0) << " events/s";
+        cout << ")\n";
+        write_json();
+        return 0;
     }
 
-    // wait for completion, then shutdown 
-    {
-        unique_lock<mutex> lk(S.m);
-        S.cv.wait(lk, [&]{ return S.total_served_nolock() == S.total_parties; });
-        S.shutdown = true;
+    if (pool && n > TimingWheel::kNil) { cerr << "Error: --pool supports at most " << TimingWheel::kNil << " instances.\n"; return 1; }
+
+    StatusLogger logger(S, log_mode, log_format, log_interval);
+    if (!quiet) {
+        logger.snapshot("Initial status");
+        logger.start();
     }
-    S.cv.notify_all();
 
-    S.print_status_snapshot("Final status");
+    jthread exporter;
+    if (metrics_path) exporter = jthread([&](stop_token st) {
+        mutex m; condition_variable_any cv;
+        unique_lock<mutex> lk(m);
+        while (!cv.wait_for(lk, st, metrics_interval, [&] { return st.stop_requested(); })) write_prometheus(S, *metrics_path);
+    });
+
+    jthread feeder;
+    if (feed) feeder = jthread(run_stream_feeder, ref(*feed), ref(S), chrono::steady_clock::now());
+
+    if (pool) {
+        run_pooled(S, rng, dist, *pool);
+    } else {
+        // start workers 
+        vector<jthread> threads; threads.reserve(n);
+        for (size_t i = 0; i < n; ++i) threads.emplace_back(instance_worker, i, std::ref(S));
+
+        run_dispatcher(S, rng, dist, [&](size_t id, int) { S.inst[id].wake.release(); });
+        for (size_t i = 0; i < n; ++i) S.inst[i].wake.release();  // shutdown
+    }
+
+    if (feeder.joinable()) feeder.join();
+    settle_stream();
+    if (!quiet) {
+        logger.stop();
+        logger.snapshot("Final status");
+    }
+    if (exporter.joinable()) {
+        exporter.request_stop();
+        exporter.join();
+        write_prometheus(S, *metrics_path);
+    }
     S.print_final_summary();
+    if (feed) print_stream_summary(*feed);
+    write_json();
     return 0;
 }
\ No newline at end of file
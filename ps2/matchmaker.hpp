@@ -0,0 +1,220 @@
+#ifndef matchmaker_hpp
+#define matchmaker_hpp
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <istream>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+// Streaming matchmaking: timestamped join/leave events, one per line,
+//     <seconds> join <player> tank|healer|dps
+//     <seconds> leave <player>
+// with '#' comments, times in seconds with up to millisecond precision and
+// non-decreasing (an earlier time is treated as "now"). A player id may
+// rejoin after leaving or being matched.
+enum class Role : std::uint8_t { Tank, Healer, Dps };
+inline constexpr const char* kRoleNames[3] = {"Tanks", "Healers", "DPS"};
+
+struct StreamEvent {
+    std::uint64_t at_ms = 0;
+    bool join = false;
+    std::uint64_t player = 0;
+    Role role = Role::Dps;
+};
+
+// Parses events from a stream in 1 MiB blocks; malformed lines are reported
+// on stderr with their line number and skipped.
+class EventReader {
+public:
+    explicit EventReader(std::istream& in) : in_(in), buf_(std::make_unique<char[]>(kBlock)) {}
+
+    bool next(StreamEvent& e) {
+        for (;;) {
+            std::string_view line;
+            if (!next_line(line)) return false;
+            ++line_no_;
+            if (auto hash = line.find('#'); hash != std::string_view::npos) line = line.substr(0, hash);
+            if (blank(line)) continue;
+            if (parse(line, e)) return true;
+            std::cerr << "Invalid event on line " << line_no_ << ": '" << line << "'\n";
+        }
+    }
+
+    std::uint64_t lines() const noexcept { return line_no_; }
+
+private:
+    static constexpr std::size_t kBlock = 1 << 20;
+
+    bool next_line(std::string_view& line) {
+        for (;;) {
+            const char* nl = static_cast<const char*>(std::memchr(buf_.get() + pos_, '\n', len_ - pos_));
+            if (nl) {
+                line = std::string_view(buf_.get() + pos_, static_cast<std::size_t>(nl - (buf_.get() + pos_)));
+                pos_ = static_cast<std::size_t>(nl - buf_.get()) + 1;
+                return true;
+            }
+            if (eof_) {
+                if (pos_ == len_) return false;
+                line = std::string_view(buf_.get() + pos_, len_ - pos_);
+                pos_ = len_;
+                return true;
+            }
+            // keep the partial line, refill behind it (lines longer than a block are cut)
+            std::size_t keep = len_ - pos_;
+            if (keep == kBlock) keep = 0;
+            std::memmove(buf_.get(), buf_.get() + pos_, keep);
+            in_.read(buf_.get() + keep, static_cast<std::streamsize>(kBlock - keep));
+            len_ = keep + static_cast<std::size_t>(in_.gcount());
+            pos_ = 0;
+            eof_ = !in_;
+        }
+    }
+
+    static bool blank(std::string_view s) {
+        return std::all_of(s.begin(), s.end(), [](char c){ return c == ' ' || c == '\t' || c == '\r'; });
+    }
+
+    static std::string_view word(std::string_view& s) {
+        std::size_t b = 0;
+        while (b < s.size() && (s[b] == ' ' || s[b] == '\t' || s[b] == '\r')) ++b;
+        std::size_t e = b;
+        while (e < s.size() && s[e] != ' ' && s[e] != '\t' && s[e] != '\r') ++e;
+        std::string_view w = s.substr(b, e - b);
+        s.remove_prefix(e);
+        return w;
+    }
+
+    // "12", "12.5" or "12.345" seconds -> milliseconds
+    static bool parse_ms(std::string_view w, std::uint64_t& ms) {
+        std::size_t dot = w.find('.');
+        std::uint64_t secs = 0, frac = 0;
+        std::string_view ip = w.substr(0, dot);
+        if (ip.empty() || std::from_chars(ip.data(), ip.data() + ip.size(), secs).ptr != ip.data() + ip.size()) return false;
+        if (dot != std::string_view::npos) {
+            std::string_view fp = w.substr(dot + 1);
+            if (fp.empty() || fp.size() > 3) return false;
+            if (std::from_chars(fp.data(), fp.data() + fp.size(), frac).ptr != fp.data() + fp.size()) return false;
+            for (std::size_t i = fp.size(); i < 3; ++i) frac *= 10;
+        }
+        ms = secs * 1000 + frac;
+        return true;
+    }
+
+    static bool parse(std::string_view s, StreamEvent& e) {
+        if (!parse_ms(word(s), e.at_ms)) return false;
+        std::string_view action = word(s), id = word(s);
+        if (id.empty() || std::from_chars(id.data(), id.data() + id.size(), e.player).ptr != id.data() + id.size()) return false;
+        if (action == "leave") {
+            e.join = false;
+        } else if (action == "join") {
+            e.join = true;
+            std::string_view r = word(s);
+            if (r == "tank" || r == "t") e.role = Role::Tank;
+            else if (r == "healer" || r == "h") e.role = Role::Healer;
+            else if (r == "dps" || r == "d") e.role = Role::Dps;
+            else return false;
+        } else {
+            return false;
+        }
+        return word(s).empty();
+    }
+
+    std::istream& in_;
+    std::unique_ptr<char[]> buf_;
+    std::size_t pos_ = 0, len_ = 0;
+    bool eof_ = false;
+    std::uint64_t line_no_ = 0;
+};
+
+// Time from joining to being placed in a party, per role.
+struct RoleWait {
+    std::uint64_t matched = 0;
+    std::uint64_t total_ms = 0;
+    std::uint64_t max_ms = 0;
+};
+
+// Per-role FIFO queues. A party (1 tank, 1 healer, 3 DPS, the longest
+// waiting of each) forms as soon as the live queues allow one. Leaves are
+// lazy: the player's record is dropped and its queue entry is skipped when
+// it reaches the front, so every event is O(1) amortized.
+class Matchmaker {
+public:
+    Matchmaker() { players_.reserve(1 << 16); }
+
+    // on_party(now_ms) is called for each party formed by this join.
+    template <class OnParty>
+    void join(std::uint64_t player, Role role, std::uint64_t now_ms, OnParty&& on_party) {
+        auto [it, fresh] = players_.try_emplace(player);
+        if (!fresh) {
+            ++duplicate_joins_;
+            return;
+        }
+        it->second = {now_ms, ++seq_, role};
+        queue_[idx(role)].push_back({player, seq_});
+        ++live_[idx(role)];
+        ++joins_;
+        while (live_[0] >= 1 && live_[1] >= 1 && live_[2] >= 3) {
+            take(Role::Tank, now_ms);
+            take(Role::Healer, now_ms);
+            for (int i = 0; i < 3; ++i) take(Role::Dps, now_ms);
+            ++parties_;
+            on_party(now_ms);
+        }
+    }
+
+    // Players that were never queued (or were already matched) are ignored.
+    void leave(std::uint64_t player) {
+        auto it = players_.find(player);
+        if (it == players_.end()) return;
+        --live_[idx(it->second.role)];
+        players_.erase(it);
+        ++leaves_;
+    }
+
+    std::uint64_t waiting(Role r) const noexcept { return live_[idx(r)]; }
+    const RoleWait& wait(Role r) const noexcept { return wait_[idx(r)]; }
+    std::uint64_t parties() const noexcept { return parties_; }
+    std::uint64_t joins() const noexcept { return joins_; }
+    std::uint64_t leaves() const noexcept { return leaves_; }
+    std::uint64_t duplicate_joins() const noexcept { return duplicate_joins_; }
+
+private:
+    struct Player { std::uint64_t joined_ms; std::uint64_t seq; Role role; };
+    struct Entry { std::uint64_t player; std::uint64_t seq; };
+
+    static constexpr int idx(Role r) noexcept { return static_cast<int>(r); }
+
+    // pops the longest-waiting live player of role r (one must exist)
+    void take(Role r, std::uint64_t now_ms) {
+        auto& q = queue_[idx(r)];
+        for (;;) {
+            Entry e = q.front();
+            q.pop_front();
+            auto it = players_.find(e.player);
+            if (it == players_.end() || it->second.seq != e.seq) continue;  // left (and maybe rejoined)
+            RoleWait& w = wait_[idx(r)];
+            std::uint64_t waited = now_ms - it->second.joined_ms;
+            ++w.matched;
+            w.total_ms += waited;
+            w.max_ms = std::max(w.max_ms, waited);
+            players_.erase(it);
+            --live_[idx(r)];
+            return;
+        }
+    }
+
+    std::unordered_map<std::uint64_t, Player> players_;  // queued players only
+    std::deque<Entry> queue_[3];
+    std::uint64_t live_[3] = {};
+    RoleWait wait_[3];
+    std::uint64_t seq_ = 0;
+    std::uint64_t parties_ = 0, joins_ = 0, leaves_ = 0, duplicate_joins_ = 0;
+};
+
+#endif
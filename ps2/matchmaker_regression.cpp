@@ -0,0 +1,134 @@
+#include "matchmaker.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<StreamEvent> read_all(const std::string& text, std::string& errors) {
+    std::istringstream in(text);
+    std::ostringstream err;
+    auto* old = std::cerr.rdbuf(err.rdbuf());
+    EventReader r(in);
+    std::vector<StreamEvent> out;
+    StreamEvent e;
+    while (r.next(e)) out.push_back(e);
+    std::cerr.rdbuf(old);
+    errors = err.str();
+    return out;
+}
+
+// joins a full party's worth of healer and dps players at now_ms
+void fill_party(Matchmaker& mm, std::uint64_t& next_id, std::uint64_t now_ms, int& formed) {
+    auto on_party = [&](std::uint64_t){ ++formed; };
+    mm.join(next_id++, Role::Healer, now_ms, on_party);
+    for (int i = 0; i < 3; ++i) mm.join(next_id++, Role::Dps, now_ms, on_party);
+}
+
+}
+
+// Event parsing (fractional seconds, comments, malformed lines) and the
+// matchmaker's party order, lazy leaves, rejoins and duplicate joins.
+int main() {
+    {
+        std::string errors;
+        auto ev = read_all(
+            "# header comment\n"
+            "\n"
+            "0 join 1 tank\n"
+            "0.5 join 2 healer   # trailing comment\n"
+            "1.05 join 3 d\r\n"
+            "12.345 leave 3\n"
+            "0.001 join 4 h\n"
+            "abc join 5 tank\n"
+            "1 join x tank\n"
+            "1 join 6 wizard\n"
+            "1 join 7 tank extra\n"
+            "1.2345 leave 3\n"
+            "1. leave 3\n"
+            "1 jump 3\n"
+            "1 leave\n"
+            "-1 leave 3\n"
+            "7 leave 4", errors);
+        assert(ev.size() == 6);
+        assert(ev[0].at_ms == 0 && ev[0].join && ev[0].player == 1 && ev[0].role == Role::Tank);
+        assert(ev[1].at_ms == 500 && ev[1].role == Role::Healer);
+        assert(ev[2].at_ms == 1050 && ev[2].player == 3 && ev[2].role == Role::Dps);
+        assert(ev[3].at_ms == 12345 && !ev[3].join && ev[3].player == 3);
+        assert(ev[4].at_ms == 1 && ev[4].role == Role::Healer);
+        assert(ev[5].at_ms == 7000 && !ev[5].join && ev[5].player == 4);
+        for (int line = 8; line <= 16; ++line)
+            assert(errors.find("line " + std::to_string(line) + ":") != std::string::npos);
+        assert(errors.find("line 7:") == std::string::npos && errors.find("line 17:") == std::string::npos);
+    }
+
+    int formed = 0;
+    auto on_party = [&](std::uint64_t){ ++formed; };
+
+    {
+        // the longest-waiting player of each role goes first
+        Matchmaker mm;
+        mm.join(1, Role::Tank, 0, on_party);
+        mm.join(2, Role::Tank, 1000, on_party);
+        std::uint64_t id = 100;
+        fill_party(mm, id, 3000, formed);
+        assert(formed == 1 && mm.parties() == 1);
+        assert(mm.wait(Role::Tank).matched == 1 && mm.wait(Role::Tank).total_ms == 3000);
+        assert(mm.waiting(Role::Tank) == 1 && mm.waiting(Role::Dps) == 0);
+
+        // matched players are no longer queued: leaving is a no-op
+        mm.leave(1);
+        assert(mm.leaves() == 0);
+        fill_party(mm, id, 4000, formed);
+        assert(formed == 2 && mm.wait(Role::Tank).max_ms == 3000 && mm.wait(Role::Tank).total_ms == 6000);
+    }
+
+    {
+        // a player who leaves and rejoins keeps only the newer queue entry
+        formed = 0;
+        Matchmaker mm;
+        mm.join(1, Role::Tank, 0, on_party);
+        mm.join(2, Role::Tank, 1000, on_party);
+        mm.leave(1);
+        mm.join(1, Role::Tank, 2000, on_party);
+        assert(mm.leaves() == 1 && mm.waiting(Role::Tank) == 2);
+        std::uint64_t id = 100;
+        fill_party(mm, id, 5000, formed);
+        assert(formed == 1 && mm.wait(Role::Tank).total_ms == 4000);  // player 2, not the stale entry of 1
+        fill_party(mm, id, 6000, formed);
+        assert(formed == 2 && mm.wait(Role::Tank).total_ms == 8000);  // then player 1 from its rejoin
+        assert(mm.waiting(Role::Tank) == 0);
+
+        // rejoining under another role leaves nothing behind in the old queue
+        mm.join(3, Role::Tank, 7000, on_party);
+        mm.leave(3);
+        mm.join(3, Role::Dps, 7000, on_party);
+        assert(mm.waiting(Role::Tank) == 0 && mm.waiting(Role::Dps) == 1);
+        mm.join(4, Role::Healer, 7000, on_party);
+        mm.join(5, Role::Dps, 7000, on_party);
+        mm.join(6, Role::Dps, 7000, on_party);
+        assert(formed == 2);
+        mm.join(7, Role::Tank, 8000, on_party);
+        assert(formed == 3 && mm.waiting(Role::Dps) == 0);
+    }
+
+    {
+        // a second join while queued is counted and ignored
+        formed = 0;
+        Matchmaker mm;
+        mm.join(1, Role::Tank, 0, on_party);
+        mm.join(1, Role::Tank, 500, on_party);
+        mm.join(1, Role::Dps, 500, on_party);
+        assert(mm.duplicate_joins() == 2 && mm.joins() == 1);
+        assert(mm.waiting(Role::Tank) == 1 && mm.waiting(Role::Dps) == 0);
+        std::uint64_t id = 100;
+        fill_party(mm, id, 1000, formed);
+        assert(formed == 1 && mm.wait(Role::Tank).total_ms == 1000);
+        mm.leave(42);
+        assert(mm.leaves() == 0);
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#ifndef metrics_hpp
+#define metrics_hpp
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+// Lock-free building blocks for the scheduler metrics. Every recording is a
+// handful of relaxed atomic operations on the recording thread's side, so
+// instances and the dispatcher never wait on each other or on an exporter
+// that reads the same counters.
+
+// HDR-style log-linear histogram of non-negative integers (microseconds
+// here): values below 32 have a bucket each, and every power-of-two range
+// above that is split into 32 equal sub-buckets, so any recorded value is
+// known to within about 3% over the whole 64-bit range.
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBits = 5;
+    static constexpr unsigned kSub = 1u << kSubBits;
+    static constexpr unsigned kBuckets = (64 - kSubBits + 1) * kSub;
+
+    void record(std::uint64_t v) noexcept {
+        counts_[index(v)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(v, std::memory_order_relaxed);
+        std::uint64_t m = max_.load(std::memory_order_relaxed);
+        while (v > m && !max_.compare_exchange_weak(m, v, std::memory_order_relaxed)) {}
+    }
+
+    std::uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+    std::uint64_t sum() const noexcept { return sum_.load(std::memory_order_relaxed); }
+    std::uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+    double mean() const noexcept { return count() ? static_cast<double>(sum()) / static_cast<double>(count()) : 0.0; }
+
+    // smallest bucket bound that covers a fraction q of the recorded values
+    std::uint64_t percentile(double q) const noexcept {
+        const std::uint64_t total = count();
+        if (total == 0) return 0;
+        std::uint64_t target = static_cast<std::uint64_t>(q * static_cast<double>(total) + 0.999999);
+        if (target == 0) target = 1;
+        std::uint64_t seen = 0;
+        for (unsigned i = 0; i < kBuckets; ++i) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= target) return std::min(upper(i), max());
+        }
+        return max();
+    }
+
+    // values recorded that are <= bound, counting only buckets that lie
+    // wholly below it (exact at powers of two, within a bucket elsewhere)
+    std::uint64_t count_le(std::uint64_t bound) const noexcept {
+        std::uint64_t c = 0;
+        for (unsigned i = 0; i < kBuckets && upper(i) <= bound; ++i) c += counts_[i].load(std::memory_order_relaxed);
+        return c;
+    }
+
+    static unsigned index(std::uint64_t v) noexcept {
+        if (v < kSub) return static_cast<unsigned>(v);
+        const unsigned msb = static_cast<unsigned>(std::bit_width(v)) - 1;
+        return (msb - kSubBits + 1) * kSub + static_cast<unsigned>((v >> (msb - kSubBits)) & (kSub - 1));
+    }
+
+    // largest value that falls in bucket i
+    static std::uint64_t upper(unsigned i) noexcept {
+        if (i < kSub) return i;
+        const unsigned msb = i / kSub + kSubBits - 1;
+        const std::uint64_t width = std::uint64_t{1} << (msb - kSubBits);
+        return (std::uint64_t{1} << msb) + (i % kSub) * width + width - 1;
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, kBuckets> counts_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+// Events per second over the last kSlots seconds. Each slot packs the
+// second it belongs to (high 32 bits) with that second's count, so a slot
+// left over from an earlier lap is recognised and restarted by one CAS.
+class RateWindow {
+public:
+    static constexpr unsigned kSlots = 64;  // longest window, in seconds
+
+    void add(std::uint64_t sec) noexcept {
+        std::atomic<std::uint64_t>& s = slots_[sec % kSlots];
+        const std::uint64_t tag = (sec & 0xffffffffu) << 32;
+        std::uint64_t cur = s.load(std::memory_order_relaxed);
+        for (;;) {
+            const std::uint64_t next = (cur & ~std::uint64_t{0xffffffffu}) == tag ? cur + 1 : tag | 1;
+            if (s.compare_exchange_weak(cur, next, std::memory_order_relaxed)) return;
+        }
+    }
+
+    // events in the `window` seconds (window <= kSlots) ending with second `last`
+    std::uint64_t count(std::uint64_t last, unsigned window) const noexcept {
+        std::uint64_t c = 0;
+        for (unsigned k = 0; k < window && k <= last; ++k) {
+            const std::uint64_t sec = last - k;
+            const std::uint64_t v = slots_[sec % kSlots].load(std::memory_order_relaxed);
+            if ((v >> 32) == (sec & 0xffffffffu)) c += v & 0xffffffffu;
+        }
+        return c;
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, kSlots> slots_{};
+};
+
+// Unbounded single-producer single-consumer FIFO in fixed-size chunks: the
+// producer only ever allocates, the consumer frees chunks it has drained,
+// and the two sides meet on one release/acquire counter.
+template <class T, std::size_t kChunk = 1024>
+class SpscChunkQueue {
+public:
+    SpscChunkQueue() : head_(new Chunk), tail_(head_) {}
+    ~SpscChunkQueue() {
+        while (head_) { Chunk* nx = head_->next; delete head_; head_ = nx; }
+    }
+    SpscChunkQueue(const SpscChunkQueue&) = delete;
+    SpscChunkQueue& operator=(const SpscChunkQueue&) = delete;
+
+    void push(const T& v) {
+        if (tpos_ == kChunk) {
+            tail_->next = new Chunk;
+            tail_ = tail_->next;
+            tpos_ = 0;
+        }
+        tail_->v[tpos_++] = v;
+        pushed_.store(pushed_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    std::optional<T> pop() {
+        if (popped_ == pushed_.load(std::memory_order_acquire)) return std::nullopt;
+        if (hpos_ == kChunk) {
+            Chunk* nx = head_->next;
+            delete head_;
+            head_ = nx;
+            hpos_ = 0;
+        }
+        ++popped_;
+        return head_->v[hpos_++];
+    }
+
+private:
+    struct Chunk {
+        T v[kChunk];
+        Chunk* next = nullptr;
+    };
+
+    Chunk* head_;                        // consumer
+    std::size_t hpos_ = 0;
+    std::uint64_t popped_ = 0;
+    alignas(64) Chunk* tail_;            // producer
+    std::size_t tpos_ = 0;
+    std::atomic<std::uint64_t> pushed_{0};
+};
+
+#endif
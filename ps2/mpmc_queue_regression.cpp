@@ -0,0 +1,70 @@
+#include "mpmc_queue.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Capacity rounding and the full/empty edges single-threaded, then several
+// producers and consumers through a small queue: every element comes out
+// exactly once, and each producer's elements in the order it pushed them.
+int main() {
+    {
+        MpmcQueue<int> q(5);  // rounds up to 8
+        assert(!q.try_pop());
+        for (int i = 0; i < 8; ++i) assert(q.try_push(i));
+        assert(!q.try_push(8));
+        assert(!q.try_push(9));
+        assert(q.try_pop() == 0);
+        assert(q.try_push(8));
+        assert(!q.try_push(9));
+        for (int i = 1; i <= 8; ++i) assert(q.try_pop() == i);
+        assert(!q.try_pop());
+
+        // many laps around the ring keep the sequence numbers straight
+        for (int lap = 0; lap < 1000; ++lap) {
+            for (int i = 0; i < 8; ++i) assert(q.try_push(lap * 8 + i));
+            assert(!q.try_push(-1));
+            for (int i = 0; i < 8; ++i) assert(q.try_pop() == lap * 8 + i);
+            assert(!q.try_pop());
+        }
+    }
+
+    {
+        constexpr unsigned kProducers = 4, kConsumers = 4;
+        constexpr std::uint64_t kPerProducer = 200'000;
+        MpmcQueue<std::uint64_t> q(64);
+        std::vector<std::atomic<std::uint8_t>> seen(kProducers * kPerProducer);
+        std::atomic<std::uint64_t> popped{0};
+        std::atomic<bool> order_ok{true};
+
+        std::vector<std::thread> threads;
+        for (unsigned p = 0; p < kProducers; ++p) threads.emplace_back([&, p]{
+            for (std::uint64_t i = 0; i < kPerProducer; ++i) {
+                const std::uint64_t v = (std::uint64_t{p} << 32) | i;
+                while (!q.try_push(v)) std::this_thread::yield();
+            }
+        });
+        for (unsigned c = 0; c < kConsumers; ++c) threads.emplace_back([&]{
+            std::vector<std::int64_t> last(kProducers, -1);
+            while (popped.load(std::memory_order_relaxed) < kProducers * kPerProducer) {
+                auto v = q.try_pop();
+                if (!v) { std::this_thread::yield(); continue; }
+                const std::uint64_t p = *v >> 32, i = *v & 0xffffffffu;
+                assert(p < kProducers && i < kPerProducer);
+                if (static_cast<std::int64_t>(i) <= last[p]) order_ok = false;
+                last[p] = static_cast<std::int64_t>(i);
+                seen[p * kPerProducer + i].fetch_add(1, std::memory_order_relaxed);
+                popped.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        for (auto& t : threads) t.join();
+
+        assert(popped.load() == kProducers * kPerProducer);
+        assert(order_ok.load());
+        for (auto& s : seen) assert(s.load() == 1);
+        assert(!q.try_pop());
+    }
+    return 0;
+}
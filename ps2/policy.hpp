@@ -0,0 +1,111 @@
+#ifndef policy_hpp
+#define policy_hpp
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <set>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Dispatch policies: which idle instance gets the next party, and which
+// pending party goes first.
+//   fifo         instances in the order they went idle, parties in formation order
+//   least-busy   the idle instance with the least total time served (min-heap)
+//   round-robin  the next idle instance by id after the last one used (ordered set)
+//   sjf          shortest job first: pending parties by duration (bucket queue),
+//                instances in idle order
+// Parties get their duration when the dispatcher first sees them, so sjf
+// works from exact predictions; the other policies never look ahead.
+enum class Policy : std::uint8_t { Fifo, LeastBusy, RoundRobin, Sjf };
+inline constexpr const char* kPolicyNames[4] = {"fifo", "least-busy", "round-robin", "sjf"};
+
+inline bool parse_policy(std::string_view s, Policy& p) {
+    for (int i = 0; i < 4; ++i)
+        if (s == kPolicyNames[i]) { p = static_cast<Policy>(i); return true; }
+    return false;
+}
+
+// Dispatcher-owned queues for one policy. Idle instances reach the
+// dispatcher through the lock-free idle queue and are moved in here, so none
+// of this is shared with other threads.
+class DispatchQueues {
+public:
+    static constexpr int kMaxSecs = 15;  // longest clear time (t2 <= 15)
+
+    explicit DispatchQueues(Policy p) : policy_(p) {}
+
+    Policy policy() const noexcept { return policy_; }
+
+    // instance id went idle having served busy_secs in total
+    void add_idle(std::uint32_t id, std::uint64_t busy_secs) {
+        switch (policy_) {
+        case Policy::LeastBusy: least_busy_.push({busy_secs, id}); break;
+        case Policy::RoundRobin: by_id_.insert(id); break;
+        default: fifo_.push_back(id); break;
+        }
+    }
+
+    std::optional<std::uint32_t> take_idle() {
+        switch (policy_) {
+        case Policy::LeastBusy: {
+            if (least_busy_.empty()) return std::nullopt;
+            std::uint32_t id = least_busy_.top().second;
+            least_busy_.pop();
+            return id;
+        }
+        case Policy::RoundRobin: {
+            if (by_id_.empty()) return std::nullopt;
+            auto it = by_id_.lower_bound(cursor_);
+            if (it == by_id_.end()) it = by_id_.begin();
+            std::uint32_t id = *it;
+            by_id_.erase(it);
+            cursor_ = id + 1;
+            return id;
+        }
+        default: {
+            if (fifo_.empty()) return std::nullopt;
+            std::uint32_t id = fifo_.front();
+            fifo_.pop_front();
+            return id;
+        }
+        }
+    }
+
+    // sjf: pending parties, one FIFO per duration and a bitmask of the
+    // non-empty ones, so the shortest is one countr_zero away
+    void add_party(int secs, std::uint64_t formed_us) {
+        const int b = std::clamp(secs, 0, kMaxSecs);
+        by_secs_[b].push_back(formed_us);
+        nonempty_ |= 1u << b;
+    }
+    bool has_party() const noexcept { return nonempty_ != 0; }
+
+    // shortest pending party: {secs, formation time}; has_party() must hold
+    std::pair<int, std::uint64_t> take_party() {
+        const int b = std::countr_zero(nonempty_);
+        std::uint64_t formed = by_secs_[b].front();
+        by_secs_[b].pop_front();
+        if (by_secs_[b].empty()) nonempty_ &= ~(1u << b);
+        return {b, formed};
+    }
+
+private:
+    Policy policy_;
+    std::deque<std::uint32_t> fifo_;
+    std::priority_queue<std::pair<std::uint64_t, std::uint32_t>,
+                        std::vector<std::pair<std::uint64_t, std::uint32_t>>,
+                        std::greater<>> least_busy_;
+    std::set<std::uint32_t> by_id_;
+    std::uint32_t cursor_ = 0;
+    std::array<std::deque<std::uint64_t>, kMaxSecs + 1> by_secs_;
+    std::uint32_t nonempty_ = 0;
+};
+
+#endif
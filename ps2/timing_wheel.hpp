@@ -0,0 +1,88 @@
+#ifndef timing_wheel_hpp
+#define timing_wheel_hpp
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel (Varghese & Lauck) over integer ticks, for up to
+// `capacity` timers identified by index. Level l has 64 slots of 64^l ticks;
+// a timer sits on the highest level where its due tick still differs from
+// the clock, and is cascaded one level down when the clock enters its slot.
+// Each timer is one link and one due tick, so memory is flat per timer and
+// arming or firing one is O(1) (amortized over at most kLevels cascades).
+// Not thread-safe; the owner serializes schedule() and advance().
+class TimingWheel {
+public:
+    static constexpr unsigned kLevels = 4;
+    static constexpr unsigned kBits = 6;
+    static constexpr std::uint32_t kSlots = 1u << kBits;
+    static constexpr std::uint32_t kNil = UINT32_MAX;
+
+    explicit TimingWheel(std::size_t capacity) : next_(capacity, kNil), due_(capacity, 0) {
+        for (auto& level : slots_) level.fill(kNil);
+    }
+
+    std::uint64_t now() const noexcept { return now_; }
+    std::size_t size() const noexcept { return size_; }
+
+    // Arms timer id (not already armed) for tick due; a due tick that has
+    // already passed fires on the next one.
+    void schedule(std::uint32_t id, std::uint64_t due) {
+        due_[id] = std::max(due, now_ + 1);
+        link(id);
+        ++size_;
+    }
+
+    // Moves the clock forward to tick `to`, calling fire(id) for every timer
+    // that comes due, in tick order.
+    template <class Fire>
+    void advance(std::uint64_t to, Fire&& fire) {
+        while (now_ < to) {
+            ++now_;
+            for (unsigned l = kLevels - 1; l > 0; --l) {
+                if (now_ & ((std::uint64_t{1} << (kBits * l)) - 1)) continue;
+                std::uint32_t id = take(l, now_);
+                while (id != kNil) {
+                    std::uint32_t nx = next_[id];
+                    link(id);
+                    id = nx;
+                }
+            }
+            std::uint32_t id = take(0, now_);
+            while (id != kNil) {
+                std::uint32_t nx = next_[id];
+                --size_;
+                fire(id);
+                id = nx;
+            }
+        }
+    }
+
+private:
+    std::uint32_t take(unsigned level, std::uint64_t tick) {
+        std::uint32_t& head = slots_[level][(tick >> (kBits * level)) & (kSlots - 1)];
+        std::uint32_t id = head;
+        head = kNil;
+        return id;
+    }
+
+    void link(std::uint32_t id) {
+        const std::uint64_t diff = due_[id] ^ now_;
+        unsigned l = 0;
+        while (l + 1 < kLevels && (diff >> (kBits * (l + 1))) != 0) ++l;
+        std::uint32_t& head = slots_[l][(due_[id] >> (kBits * l)) & (kSlots - 1)];
+        next_[id] = head;
+        head = id;
+    }
+
+    std::array<std::array<std::uint32_t, kSlots>, kLevels> slots_;
+    std::vector<std::uint32_t> next_;
+    std::vector<std::uint64_t> due_;
+    std::uint64_t now_ = 0;
+    std::size_t size_ = 0;
+};
+
+#endif
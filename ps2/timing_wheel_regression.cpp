@@ -0,0 +1,137 @@
+#include "timing_wheel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// A wheel plus the tick every armed timer should fire at. advance() checks
+// that the wheel fires exactly the due timers, in tick order.
+struct Checked {
+    explicit Checked(std::size_t capacity) : wheel(capacity), want(capacity, 0) {}
+
+    void schedule(std::uint32_t id, std::uint64_t due) {
+        want[id] = std::max(due, wheel.now() + 1);
+        armed.push_back(id);
+        wheel.schedule(id, due);
+    }
+
+    void advance(std::uint64_t to) {
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> fired;
+        wheel.advance(to, [&](std::uint32_t id){ fired.push_back({wheel.now(), id}); });
+        assert(wheel.now() == to);
+
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> ref;
+        std::vector<std::uint32_t> still;
+        for (std::uint32_t id : armed) {
+            if (want[id] <= to) ref.push_back({want[id], id});
+            else still.push_back(id);
+        }
+        armed = still;
+        std::sort(ref.begin(), ref.end());
+
+        // ticks come out in order; timers sharing a tick in any order
+        for (std::size_t i = 1; i < fired.size(); ++i) assert(fired[i - 1].first <= fired[i].first);
+        std::sort(fired.begin(), fired.end());
+        assert(fired == ref);
+        assert(wheel.size() == armed.size());
+    }
+
+    TimingWheel wheel;
+    std::vector<std::uint64_t> want;
+    std::vector<std::uint32_t> armed;
+};
+
+}
+
+// Due ticks on and around the 64 / 4096 / 64^3 slot boundaries, timers armed
+// while the wheel's clock lags the caller's (the pooled timer thread does not
+// advance an empty wheel), due ticks that have already passed, and a random
+// interleaving of schedule() and advance(), all against a sorted reference.
+int main() {
+    {
+        Checked c(64);
+        std::uint32_t id = 0;
+        for (std::uint64_t edge : {std::uint64_t{64}, std::uint64_t{4096}, std::uint64_t{1} << 18})
+            for (std::uint64_t d : {edge - 1, edge, edge + 1, 2 * edge - 1, 2 * edge, 2 * edge + 1})
+                c.schedule(id++, d);
+        c.advance(63);
+        c.advance(64);
+        c.advance(4095);
+        c.advance(4097);
+        c.advance(std::uint64_t{1} << 19 | 1);
+        assert(c.wheel.size() == 0);
+    }
+
+    {
+        // past the top level's span: the timer laps level 3 until it is due
+        Checked c(4);
+        c.schedule(0, (std::uint64_t{1} << 24) + 70);
+        c.schedule(1, (std::uint64_t{1} << 25) + 3);
+        c.advance(std::uint64_t{1} << 24);
+        c.advance((std::uint64_t{1} << 25) + 10);
+    }
+
+    {
+        // the wheel sat empty at tick 10 while real time moved on to 5000
+        Checked c(16);
+        c.advance(10);
+        const std::uint64_t real = 5000;
+        for (std::uint32_t id = 0; id < 8; ++id) c.schedule(id, real + 500 * id);
+        assert(c.wheel.now() == 10);
+        c.advance(real + 1);
+        c.advance(real + 1000);
+        c.schedule(8, real + 1200);
+        c.advance(real + 4000);
+
+        // again, across a level-2 boundary far ahead of the stale clock
+        const std::uint64_t later = 300'000;
+        for (std::uint32_t id = 0; id < 8; ++id) c.schedule(id, later + 64 * id);
+        c.advance(later + 100);
+        c.advance(later + 1000);
+        assert(c.wheel.size() == 0);
+    }
+
+    {
+        // due ticks at or before now() fire on the next tick
+        Checked c(4);
+        c.advance(100);
+        c.schedule(0, 50);
+        c.schedule(1, 100);
+        c.schedule(2, 0);
+        c.schedule(3, 101);
+        c.advance(101);
+        assert(c.wheel.size() == 0);
+    }
+
+    {
+        std::mt19937_64 rng(12345);
+        const std::uint32_t n = 2000;
+        Checked c(n);
+        std::vector<std::uint32_t> idle;
+        for (std::uint32_t id = 0; id < n; ++id) idle.push_back(id);
+        std::uint64_t real = 0;
+        for (int round = 0; round < 400; ++round) {
+            real += rng() % 3000;
+            const std::uint64_t spans[] = {70, 5000, 300'000};
+            for (int k = 0; k < 10 && !idle.empty(); ++k) {
+                std::uint32_t id = idle.back();
+                idle.pop_back();
+                std::uint64_t d = real + rng() % spans[rng() % 3];
+                if (rng() % 8 == 0) d = c.wheel.now() - std::min<std::uint64_t>(c.wheel.now(), rng() % 10);
+                c.schedule(id, d);
+            }
+            std::vector<std::uint32_t> before = c.armed;
+            c.advance(std::max(c.wheel.now(), real - std::min<std::uint64_t>(real, rng() % 2000)));
+            for (std::uint32_t id : before)
+                if (c.want[id] <= c.wheel.now()) idle.push_back(id);
+        }
+        c.advance(c.wheel.now() + 400'000);
+        assert(c.wheel.size() == 0);
+    }
+    return 0;
+}